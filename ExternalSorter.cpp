@@ -0,0 +1,281 @@
+#include "mr/ExternalSorter.hpp"
+#include "mr/LineReader.hpp"
+#include "mr/RecordFormat.hpp"
+#include "mr/RunMerge.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace mr {
+
+// Runs merged at once; more than this are first merged into bigger runs
+// so open files and read windows stay bounded.
+static constexpr std::size_t kMaxFanIn = 128;
+
+// Sort-permutation entry kept per buffered pair during a spill
+static constexpr std::size_t kOrderBytes = sizeof(std::uint32_t);
+
+namespace {
+
+// Buffered pairs walked in a precomputed sorted order; the in-memory
+// counterpart of RunMerge (same valid() / word() / count() / pop() walk)
+class MemorySource {
+public:
+    MemorySource(const KVBuffer& pairs, const std::vector<std::uint32_t>& order)
+        : pairs_(pairs), order_(order) {}
+
+    bool             valid() const { return pos_ < order_.size(); }
+    std::string_view word() const  { return pairs_.key(order_[pos_]); }
+    int              count() const { return pairs_.count(order_[pos_]); }
+    void             pop()         { ++pos_; }
+
+private:
+    const KVBuffer&                   pairs_;
+    const std::vector<std::uint32_t>& order_;
+    std::size_t                       pos_ = 0;
+};
+
+// The values of the current word, pulled from the source on demand
+template <class Source>
+class GroupValues : public IValueStream {
+public:
+    GroupValues(Source& src, const std::string& word) : src_(src), word_(word) {}
+
+    bool next(int& value) override {
+        if (!src_.valid() || src_.word() != word_) return false;
+        value = src_.count();
+        src_.pop();
+        return true;
+    }
+
+    // Skip whatever the consumer left unread
+    void drain() {
+        while (src_.valid() && src_.word() == word_) src_.pop();
+    }
+
+private:
+    Source&            src_;
+    const std::string& word_;
+};
+
+// Formats a sorted run in the intermediate format (front-coded blocks
+// when binary) and hands it to the sink in large writes
+class RunWriter {
+public:
+    static constexpr std::size_t kFlushBytes = 1u << 20;
+
+    explicit RunWriter(AppendSink& out) : out_(out), records_(intermediateFormat(), true) {}
+
+    void add(std::string_view word, int count) {
+        records_.add(word, count);
+        if (records_.size() >= kFlushBytes) finish();
+    }
+    void finish() {
+        out_.write(records_.data());
+        records_.clear();
+    }
+
+private:
+    AppendSink&  out_;
+    RecordBuffer records_;
+};
+
+// A group already folded into one value by the combiner
+class SingleValue : public IValueStream {
+public:
+    explicit SingleValue(int value) : value_(value) {}
+
+    bool next(int& value) override {
+        if (done_) return false;
+        value = value_;
+        done_ = true;
+        return true;
+    }
+
+private:
+    int  value_;
+    bool done_ = false;
+};
+
+// Folds the values of src's current word with combine and pops them
+template <class Source, class Combine>
+int foldGroup(Source& src, const std::string& word, Combine&& combine) {
+    int value = src.count();
+    for (src.pop(); src.valid() && src.word() == word; src.pop()) {
+        value = combine(word, value, src.count());
+    }
+    return value;
+}
+
+template <class Source>
+void streamGroups(Source& src, const ExternalSorter::GroupStreamFn& fn) {
+    std::string word;
+    while (src.valid()) {
+        const std::string_view w = src.word();
+        word.assign(w.data(), w.size());
+        GroupValues<Source> values(src, word);
+        fn(word, values);
+        values.drain();
+    }
+}
+
+} // namespace
+
+ExternalSorter::ExternalSorter(FileManager& fm, std::string runPrefix, std::size_t memoryBytes)
+    : fm_(fm),
+      runPrefix_(std::move(runPrefix)),
+      memoryBytes_(memoryBytes ? memoryBytes : kDefaultMemoryBytes) {}
+
+ExternalSorter::~ExternalSorter() {
+    removeRuns();
+}
+
+void ExternalSorter::add(std::string_view word, int count) {
+    if (!pending().fits(word.size())) spill();   // 32-bit key offsets
+    if (!combine_) {
+        buffer_.push(word, count);
+    } else if (!combineFn_) {
+        table_.add(word, count);
+    } else {
+        table_.merge(word, hashKey(word), count,
+                     [&](int a, int b) { return combineFn_(word, a, b); });
+    }
+    if (pendingBytes() >= memoryBytes_) {
+        spill();
+    }
+}
+
+std::size_t ExternalSorter::pendingBytes() const {
+    const std::size_t sortBytes = pending().size() * kOrderBytes;
+    return (combine_ ? table_.memoryBytes() : buffer_.memoryBytes()) + sortBytes;
+}
+
+void ExternalSorter::addFile(const std::string& path) {
+    RecordReader reader(path);
+    std::string_view word;
+    int count = 0;
+    while (reader.next(word, count)) add(word, count);
+}
+
+void ExternalSorter::addSortedRun(InputSplit run) {
+    runs_.push_back(Run{ std::move(run), false });
+}
+
+void ExternalSorter::spill() {
+    const KVBuffer& pairs = pending();
+    if (pairs.empty()) return;
+    pairs.sortedOrder(order_);
+
+    std::string path = nextRunPath();
+    AppendSink out = fm_.openAppend(path, /*truncate*/ true);
+    RunWriter writer(out);
+    for (std::uint32_t i : order_) {
+        writer.add(pairs.key(i), pairs.count(i));
+    }
+    writer.finish();
+    out.close();
+
+    runs_.push_back(Run{ InputSplit{ std::move(path) }, true });
+    buffer_.clear();
+    table_.clear();
+}
+
+void ExternalSorter::forEachGroup(const GroupFn& fn) {
+    std::vector<int> counts;
+    forEachGroupStream([&](const std::string& word, IValueStream& values) {
+        collectValues(values, counts);
+        fn(word, counts);
+    });
+}
+
+void ExternalSorter::forEachGroupStream(const GroupStreamFn& fn) {
+    if (runs_.empty()) {
+        // Everything fit under the cap: group straight from memory
+        const KVBuffer& pairs = pending();
+        pairs.sortedOrder(order_);
+        MemorySource src(pairs, order_);
+        streamGroups(src, fn);
+        buffer_.clear();
+        table_.clear();
+        return;
+    }
+
+    spill();
+    compactRuns();
+    {
+        RunMerge merge(runRanges(0, runs_.size()), mergeWindowBytes(runs_.size()));
+        if (combine_) {
+            // Every run holds a partial value per word: fold them first
+            std::string word;
+            while (merge.valid()) {
+                const std::string_view w = merge.word();
+                word.assign(w.data(), w.size());
+                SingleValue value(foldGroup(merge, word, [this](std::string_view k, int a, int b) {
+                    return combine(k, a, b);
+                }));
+                fn(word, value);
+            }
+        } else {
+            streamGroups(merge, fn);
+        }
+    }
+    removeRuns();
+}
+
+std::size_t ExternalSorter::mergeWindowBytes(std::size_t fanIn) const {
+    // Read windows share the memory cap (mapped windows are mostly page cache)
+    const std::size_t w = memoryBytes_ / (fanIn + 1);
+    return std::min<std::size_t>(LineReader::kDefaultWindowBytes,
+                                 std::max<std::size_t>(w, 64u << 10));
+}
+
+void ExternalSorter::compactRuns() {
+    while (runs_.size() > kMaxFanIn) {
+        const std::vector<InputSplit> batch = runRanges(0, kMaxFanIn);
+
+        std::string path = nextRunPath();
+        {
+            AppendSink out = fm_.openAppend(path, /*truncate*/ true);
+            RunWriter writer(out);
+            std::string word;
+            for (RunMerge merge(batch, mergeWindowBytes(batch.size())); merge.valid();) {
+                if (!combine_) {
+                    writer.add(merge.word(), merge.count());
+                    merge.pop();
+                    continue;
+                }
+                const std::string_view w = merge.word();
+                word.assign(w.data(), w.size());
+                writer.add(word, foldGroup(merge, word, [this](std::string_view k, int a, int b) {
+                    return combine(k, a, b);
+                }));
+            }
+            writer.finish();
+        }
+        for (std::size_t i = 0; i < kMaxFanIn; ++i) {
+            if (runs_[i].owned) fm_.removeFile(runs_[i].range.path);
+        }
+        runs_.erase(runs_.begin(), runs_.begin() + kMaxFanIn);
+        runs_.push_back(Run{ InputSplit{ std::move(path) }, true });
+    }
+}
+
+std::string ExternalSorter::nextRunPath() {
+    return runPrefix_ + std::to_string(runSeq_++) + ".txt";
+}
+
+std::vector<InputSplit> ExternalSorter::runRanges(std::size_t begin, std::size_t end) const {
+    std::vector<InputSplit> ranges;
+    ranges.reserve(end - begin);
+    for (std::size_t i = begin; i < end; ++i) ranges.push_back(runs_[i].range);
+    return ranges;
+}
+
+void ExternalSorter::removeRuns() {
+    for (const auto& r : runs_) {
+        if (r.owned) fm_.removeFile(r.range.path);
+    }
+    runs_.clear();
+}
+
+} // namespace mr
@@ -1,13 +1,119 @@
 #include "mr/FileManager.hpp"
+#include <charconv>
 #include <filesystem>
 #include <fstream>
+#include <utility>
 
 namespace fs = std::filesystem;
 
 namespace mr {
 
+void appendRecord(std::string& out, std::string_view key, long long count) {
+    char num[24];
+    const auto res = std::to_chars(num, num + sizeof(num), count);
+    out.append(key.data(), key.size());
+    out.push_back('\t');
+    out.append(num, static_cast<std::size_t>(res.ptr - num));
+    out.push_back('\n');
+}
+
+// ------------------------- AppendSink -------------------------
+AppendSink::AppendSink(const std::string& path, bool truncate, std::size_t bufferBytes)
+    : path_(path), capacity_(bufferBytes ? bufferBytes : kDefaultBufferBytes) {
+    // Our own buffer does the batching; keep the stream unbuffered so
+    // every flush is a single write of the whole block.
+    out_.rdbuf()->pubsetbuf(nullptr, 0);
+    out_.open(path_, std::ios::binary | (truncate ? std::ios::trunc : std::ios::app));
+    buf_.reserve(capacity_);
+}
+
+AppendSink::~AppendSink() {
+    close();
+}
+
+AppendSink::AppendSink(AppendSink&& other) noexcept
+    : out_(std::move(other.out_)),
+      path_(std::move(other.path_)),
+      buf_(std::move(other.buf_)),
+      capacity_(other.capacity_) {
+    other.buf_.clear();
+}
+
+AppendSink& AppendSink::operator=(AppendSink&& other) noexcept {
+    if (this != &other) {
+        close();
+        out_      = std::move(other.out_);
+        path_     = std::move(other.path_);
+        buf_      = std::move(other.buf_);
+        capacity_ = other.capacity_;
+        other.buf_.clear();
+    }
+    return *this;
+}
+
+void AppendSink::reserveFor(std::size_t n) {
+    if (buf_.size() + n > capacity_) flush();
+}
+
+void AppendSink::write(std::string_view bytes) {
+    if (bytes.size() >= capacity_) {
+        // Oversized payload: drain what we have and hand it straight to the OS
+        flush();
+        out_.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        return;
+    }
+    reserveFor(bytes.size());
+    buf_.append(bytes.data(), bytes.size());
+}
+
+void AppendSink::put(char c) {
+    reserveFor(1);
+    buf_.push_back(c);
+}
+
+void AppendSink::writeLine(std::string_view line) {
+    write(line);
+    put('\n');
+}
+
+void AppendSink::writeRecord(std::string_view key, long long count) {
+    // 20 digits + sign covers any long long
+    const std::size_t maxLen = key.size() + 23;
+    if (maxLen >= capacity_) {
+        std::string rec;
+        appendRecord(rec, key, count);
+        write(rec);
+        return;
+    }
+    reserveFor(maxLen);
+    appendRecord(buf_, key, count);
+}
+
+void AppendSink::flush() {
+    if (!buf_.empty() && out_.is_open()) {
+        out_.write(buf_.data(), static_cast<std::streamsize>(buf_.size()));
+    }
+    buf_.clear();
+    if (out_.is_open()) out_.flush();
+}
+
+void AppendSink::close() {
+    if (!out_.is_open()) return;
+    flush();
+    out_.close();
+}
+
+// ------------------------- FileManager -------------------------
 void FileManager::ensureDir(const std::string& dir) {
+    if (dir.empty()) return;
+    std::lock_guard<std::mutex> lk(dirMu_);
+    if (knownDirs_.count(dir)) return;
     fs::create_directories(dir);
+    knownDirs_.insert(dir);
+}
+
+void FileManager::ensureParentDir(const std::string& path) {
+    ensureDir(fs::path(path).parent_path().string());
 }
 
 bool FileManager::exists(const std::string& path) {
@@ -15,17 +121,22 @@ bool FileManager::exists(const std::string& path) {
 }
 
 void FileManager::writeAll(const std::string& path, const std::string& data) {
-    ensureDir(fs::path(path).parent_path().string());
+    ensureParentDir(path);
     std::ofstream out(path, std::ios::trunc);
     out << data;
 }
 
 void FileManager::appendLine(const std::string& path, const std::string& line) {
-    ensureDir(fs::path(path).parent_path().string());
+    ensureParentDir(path);
     std::ofstream out(path, std::ios::app);
     out << line << "\n";
 }
 
+AppendSink FileManager::openAppend(const std::string& path, bool truncate, std::size_t bufferBytes) {
+    ensureParentDir(path);
+    return AppendSink(path, truncate, bufferBytes);
+}
+
 std::vector<std::string> FileManager::readAllLines(const std::string& path) {
     std::vector<std::string> lines;
     std::ifstream in(path);
@@ -45,8 +156,13 @@ std::vector<std::string> FileManager::listFiles(const std::string& dir) {
     return files;
 }
 
+bool FileManager::removeFile(const std::string& path) {
+    std::error_code ec;
+    return fs::remove(path, ec);
+}
+
 bool FileManager::writeEmptyFile(const std::string& path) {
-    ensureDir(fs::path(path).parent_path().string());
+    ensureParentDir(path);
     std::ofstream out(path, std::ios::trunc | std::ios::binary);
     return static_cast<bool>(out);
 }
@@ -0,0 +1,304 @@
+#include "mr/LineReader.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #define NOMINMAX
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace mr {
+
+namespace {
+
+// mmap offsets must be multiples of this (page size / allocation granularity)
+std::size_t mapGranularity() {
+#ifdef _WIN32
+    SYSTEM_INFO si{};
+    ::GetSystemInfo(&si);
+    return si.dwAllocationGranularity;
+#else
+    const long pg = ::sysconf(_SC_PAGESIZE);
+    return pg > 0 ? static_cast<std::size_t>(pg) : 4096;
+#endif
+}
+
+} // namespace
+
+LineReader::LineReader(const std::string& path, std::size_t windowBytes)
+    : LineReader(path, 0, kToEnd, windowBytes) {}
+
+LineReader::LineReader(const std::string& path, std::uint64_t offset,
+                       std::uint64_t length, std::size_t windowBytes)
+    : window_(windowBytes) {
+    if (length != kToEnd) limit_ = offset + length;
+    const std::size_t gran = mapGranularity();
+    window_ = std::max(window_, gran);
+    window_ = (window_ + gran - 1) / gran * gran;
+
+    if (openMapped(path)) {
+        open_ = mapped_ = true;
+    } else {
+        // ---- buffered fallback ----
+        in_.open(path, std::ios::binary);
+        if (!in_) return;
+        buf_.resize(window_);
+        open_ = true;
+    }
+    if (offset > 0) alignToRange(offset);
+}
+
+// A line belongs to the range holding its first byte. Position the reader
+// at offset - 1 and drop one line: that skips a partial line, and skips
+// nothing when the byte before offset is the previous line's newline.
+void LineReader::alignToRange(std::uint64_t offset) {
+    const std::uint64_t from = offset - 1;
+    if (mapped_) {
+        pos_ = from;
+    } else {
+        in_.seekg(static_cast<std::streamoff>(from));
+        if (!in_) { eof_ = true; return; }
+        bufPos_ = from;
+    }
+    const std::uint64_t limit = limit_;
+    limit_ = kToEnd;
+    std::string_view partial;
+    next(partial);
+    limit_ = limit;
+}
+
+LineReader::~LineReader() {
+    closeMapped();
+}
+
+std::string_view LineReader::stripCR(std::string_view line) {
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    return line;
+}
+
+bool LineReader::next(std::string_view& line) {
+    if (!open_) return false;
+    return mapped_ ? nextMapped(line) : nextBuffered(line);
+}
+
+void LineReader::seek(std::uint64_t offset) {
+    if (!open_) return;
+    if (mapped_) {
+        pos_ = offset;
+        return;
+    }
+    in_.clear();
+    in_.seekg(static_cast<std::streamoff>(offset));
+    begin_ = end_ = 0;
+    eof_    = !in_;
+    bufPos_ = offset;
+}
+
+bool LineReader::read(std::size_t n, std::string_view& bytes) {
+    if (!open_) return false;
+    return mapped_ ? readMapped(n, bytes) : readBuffered(n, bytes);
+}
+
+// ------------------------- mapped mode -------------------------
+bool LineReader::openMapped(const std::string& path) {
+#ifdef _WIN32
+    HANDLE f = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                             OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (f == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER sz{};
+    if (!::GetFileSizeEx(f, &sz) || sz.QuadPart == 0) {
+        // Empty files cannot be mapped; the buffered path handles them
+        ::CloseHandle(f);
+        return false;
+    }
+    HANDLE m = ::CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m) { ::CloseHandle(f); return false; }
+
+    file_     = f;
+    mapping_  = m;
+    fileSize_ = static_cast<std::uint64_t>(sz.QuadPart);
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    fd_       = fd;
+    fileSize_ = static_cast<std::uint64_t>(st.st_size);
+#endif
+    if (!remap(0)) {
+        closeMapped();
+        return false;
+    }
+    return true;
+}
+
+bool LineReader::remap(std::uint64_t offset) {
+    unmap();
+
+    const std::uint64_t gran = mapGranularity();
+    viewOff_ = offset / gran * gran;
+    viewLen_ = static_cast<std::size_t>(
+        std::min<std::uint64_t>(window_, fileSize_ - viewOff_));
+
+#ifdef _WIN32
+    void* p = ::MapViewOfFile(static_cast<HANDLE>(mapping_), FILE_MAP_READ,
+                              static_cast<DWORD>(viewOff_ >> 32),
+                              static_cast<DWORD>(viewOff_ & 0xFFFFFFFFu),
+                              viewLen_);
+    if (!p) return false;
+#else
+    void* p = ::mmap(nullptr, viewLen_, PROT_READ, MAP_PRIVATE, fd_,
+                     static_cast<off_t>(viewOff_));
+    if (p == MAP_FAILED) return false;
+    ::madvise(p, viewLen_, MADV_SEQUENTIAL);
+#endif
+    view_ = static_cast<const char*>(p);
+    return true;
+}
+
+void LineReader::unmap() {
+    if (!view_) return;
+#ifdef _WIN32
+    ::UnmapViewOfFile(view_);
+#else
+    ::munmap(const_cast<char*>(view_), viewLen_);
+#endif
+    view_ = nullptr;
+}
+
+void LineReader::closeMapped() {
+    unmap();
+#ifdef _WIN32
+    if (mapping_) ::CloseHandle(static_cast<HANDLE>(mapping_)), mapping_ = nullptr;
+    if (file_)    ::CloseHandle(static_cast<HANDLE>(file_)),    file_    = nullptr;
+#else
+    if (fd_ >= 0) ::close(fd_), fd_ = -1;
+#endif
+}
+
+bool LineReader::nextMapped(std::string_view& line) {
+    while (pos_ < fileSize_ && pos_ < limit_) {
+        const std::uint64_t viewEnd = viewOff_ + viewLen_;
+        if (!view_ || pos_ < viewOff_ || pos_ >= viewEnd) {
+            if (!remap(pos_)) return false;
+            continue;
+        }
+
+        const char* start = view_ + (pos_ - viewOff_);
+        const std::size_t avail = static_cast<std::size_t>(viewEnd - pos_);
+        const char* nl = static_cast<const char*>(std::memchr(start, '\n', avail));
+
+        if (nl) {
+            const std::size_t len = static_cast<std::size_t>(nl - start);
+            line = stripCR(std::string_view(start, len));
+            pos_ += len + 1;
+            return true;
+        }
+        if (viewEnd >= fileSize_) {
+            // last line without a trailing newline
+            line = stripCR(std::string_view(start, avail));
+            pos_ = fileSize_;
+            return true;
+        }
+
+        // The line crosses the window: slide the window to start at it,
+        // doubling the window only when one line is longer than the window.
+        const std::uint64_t gran = mapGranularity();
+        if (viewOff_ == pos_ / gran * gran) window_ *= 2;
+        if (!remap(pos_)) return false;
+    }
+    return false;
+}
+
+bool LineReader::readMapped(std::size_t n, std::string_view& bytes) {
+    const std::uint64_t end = std::min(fileSize_, limit_);
+    if (pos_ > end || end - pos_ < n) return false;
+
+    if (!view_ || pos_ < viewOff_ || pos_ + n > viewOff_ + viewLen_) {
+        // Window must hold [pos_, pos_ + n) after aligning down to a granule
+        const std::uint64_t gran = mapGranularity();
+        const std::uint64_t need = pos_ + n - pos_ / gran * gran;
+        while (window_ < need) window_ *= 2;
+        if (!remap(pos_)) return false;
+    }
+    bytes = std::string_view(view_ + (pos_ - viewOff_), n);
+    pos_ += n;
+    return true;
+}
+
+// ------------------------- buffered mode -------------------------
+bool LineReader::nextBuffered(std::string_view& line) {
+    if (bufPos_ >= limit_) return false;
+    while (true) {
+        const char* start = buf_.data() + begin_;
+        const std::size_t avail = end_ - begin_;
+        const char* nl = static_cast<const char*>(std::memchr(start, '\n', avail));
+
+        if (nl) {
+            const std::size_t len = static_cast<std::size_t>(nl - start);
+            line = stripCR(std::string_view(start, len));
+            begin_  += len + 1;
+            bufPos_ += len + 1;
+            return true;
+        }
+        if (eof_) {
+            if (avail == 0) return false;
+            line = stripCR(std::string_view(start, avail));
+            begin_   = end_;
+            bufPos_ += avail;
+            return true;
+        }
+
+        // Compact the partial line to the front, then refill behind it
+        if (begin_ > 0) {
+            std::memmove(buf_.data(), start, avail);
+            begin_ = 0;
+            end_   = avail;
+        }
+        if (end_ == buf_.size()) buf_.resize(buf_.size() * 2);
+
+        in_.read(buf_.data() + end_, static_cast<std::streamsize>(buf_.size() - end_));
+        const std::size_t got = static_cast<std::size_t>(in_.gcount());
+        end_ += got;
+        if (got == 0 || !in_) eof_ = true;
+    }
+}
+
+bool LineReader::readBuffered(std::size_t n, std::string_view& bytes) {
+    if (limit_ != kToEnd && (bufPos_ > limit_ || limit_ - bufPos_ < n)) return false;
+    while (end_ - begin_ < n) {
+        if (eof_) return false;
+
+        // Compact the unread bytes to the front, then refill behind them
+        const std::size_t avail = end_ - begin_;
+        if (begin_ > 0) {
+            std::memmove(buf_.data(), buf_.data() + begin_, avail);
+            begin_ = 0;
+            end_   = avail;
+        }
+        if (buf_.size() < n) buf_.resize(n);
+
+        in_.read(buf_.data() + end_, static_cast<std::streamsize>(buf_.size() - end_));
+        const std::size_t got = static_cast<std::size_t>(in_.gcount());
+        end_ += got;
+        if (got == 0 || !in_) eof_ = true;
+    }
+    bytes = std::string_view(buf_.data() + begin_, n);
+    begin_  += n;
+    bufPos_ += n;
+    return true;
+}
+
+} // namespace mr
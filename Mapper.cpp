@@ -1,8 +1,7 @@
 #include "mr/Mapper.hpp"
 
-#include <cctype>
-#include <sstream>
-#include <functional>   // std::hash
+#include <cstdint>
+#include <stdexcept>
 #include <utility>      // std::move (optional)
 
 namespace mr {
@@ -22,57 +21,151 @@ Mapper::Mapper(FileManager& fm,
       tempDir_(tempDir),
       flushThreshold_(flushThreshold ? flushThreshold : 1), // avoid 0 threshold
       mapperId_(mapperId),
-      numReducers_(numReducers > 0 ? numReducers : 1) {}
-
-void Mapper::map(const std::string& /*fileName*/, const std::string& line) {
-    // normalize: lowercase letters; everything else -> space
-    std::string cleaned = line;
-    for (char& c : cleaned) {
-        unsigned char uc = static_cast<unsigned char>(c);
-        c = std::isalpha(uc) ? static_cast<char>(std::tolower(uc)) : ' ';
-    }
+      numReducers_(numReducers > 0 ? numReducers : 1),
+      partitioner_(std::make_shared<HashPartitioner>(static_cast<std::size_t>(numReducers_))),
+      files_(std::make_shared<PartitionFiles>(fm, tempDir, mapperId_, numReducers_)),
+      blocks_(numReducers_) {}
 
-    std::istringstream iss(cleaned);
-    std::string token;
+Mapper::Mapper(FileManager& fm,
+               std::shared_ptr<PartitionSink> files,
+               std::size_t flushThreshold)
+    : fileManager_(fm),
+      flushThreshold_(flushThreshold ? flushThreshold : 1),
+      mapperId_(files->mapperId()),
+      numReducers_(static_cast<int>(files->numPartitions())),
+      partitioner_(std::make_shared<HashPartitioner>(files->numPartitions())),
+      files_(std::move(files)),
+      blocks_(numReducers_) {}
+
+Mapper::~Mapper() {
+    pushBlocks();
+}
 
-    while (iss >> token) {
-        buffer_.push_back({ token, 1 });
+void Mapper::enableCombiner(std::size_t memoryBudgetBytes, CombineFn combine) {
+    exportKV();
+    combineBudget_ = memoryBudgetBytes;
+    combineFn_     = std::move(combine);
+}
 
-        if (buffer_.size() >= flushThreshold_) {
+void Mapper::enableSortedRuns(std::size_t runBufferBytes) {
+    exportKV();
+    runBufferBytes_ = runBufferBytes ? runBufferBytes : kDefaultRunBufferBytes;
+}
+
+void Mapper::setPartitioner(std::shared_ptr<const Partitioner> partitioner) {
+    if (!partitioner || partitioner->numPartitions() != static_cast<std::size_t>(numReducers_))
+        throw std::invalid_argument("Partitioner does not match the number of reducers");
+    exportKV(); // pairs already buffered keep the old routing
+    partitioner_ = std::move(partitioner);
+}
+
+void Mapper::map(const std::string& /*fileName*/, std::string_view line) {
+    // lowercase ASCII words; everything else separates tokens
+    tokenizer_.forEachToken(line, [this](std::string_view token) { emit(token, 1); });
+}
+
+void Mapper::emit(std::string_view word, int count) {
+    const std::uint64_t h = hashKey(word);
+    if (combineBudget_ > 0) {
+        if (!combined_.fits(word.size())) exportKV();
+        if (combineFn_) {
+            combined_.merge(word, h, count, [&](int a, int b) { return combineFn_(word, a, b); });
+        } else {
+            combined_.add(word, h, count);
+        }
+        // The table's real footprint (keys, columns, probe index)
+        if (combined_.memoryBytes() >= combineBudget_) {
             exportKV();
         }
+        return;
+    }
+
+    if (!buffer_.fits(word.size())) exportKV();   // 32-bit key offsets
+    buffer_.push(word, count, h,
+                 static_cast<std::uint32_t>(partitioner_->partitionHashed(word, h)));
+
+    if (runBufferBytes_ ? buffer_.memoryBytes() >= runBufferBytes_
+                        : buffer_.size() >= flushThreshold_) {
+        exportKV();
     }
 }
 
 void Mapper::flush() {
     exportKV();
+    pushBlocks();
+    files_->flush();
 }
 
 void Mapper::exportKV() {
-    if (buffer_.empty()) return;
-
-    fileManager_.ensureDir(tempDir_);
-
-    const std::hash<std::string> hasher;
+    if (buffer_.empty() && combined_.empty()) return;
+    if (runBufferBytes_ > 0) {
+        exportSortedRuns();
+        return;
+    }
 
-    for (const auto& kv : buffer_) {
-        const std::string& word = kv.first;
-        const int count = kv.second;
+    const KVBuffer& combined = combined_.entries();
+    for (std::size_t i = 0; i < combined.size(); ++i) {
+        exportRecord(partitioner_->partitionHashed(combined.key(i), combined.hash(i)),
+                     combined.key(i), combined.count(i));
+    }
+    combined_.clear();
 
-        // SAFE: hash returns size_t, so modulus should be size_t too
-        const std::size_t bucketSz =
-            hasher(word) % static_cast<std::size_t>(numReducers_);
-        const int bucket = static_cast<int>(bucketSz);
+    for (std::size_t i = 0; i < buffer_.size(); ++i) {
+        exportRecord(buffer_.partition(i), buffer_.key(i), buffer_.count(i));
+    }
+    buffer_.clear(); // keeps the arena and column capacity for the next round
+}
 
-        // File name: tempDir_/m<mapperId>_r<bucket>.txt
-        const std::string path =
-            tempDir_ + "/m" + std::to_string(mapperId_) +
-            "_r" + std::to_string(bucket) + ".txt";
+void Mapper::exportSortedRuns() {
+    const KVBuffer& combined = combined_.entries();
+    for (std::size_t i = 0; i < combined.size(); ++i) {
+        const std::string_view key = combined.key(i);
+        buffer_.push(key, combined.count(i), combined.hash(i),
+                     static_cast<std::uint32_t>(partitioner_->partitionHashed(key, combined.hash(i))));
+    }
+    combined_.clear();
+
+    // (bucket, key) order: each bucket's pairs are one contiguous sorted
+    // stretch, with equal keys adjacent
+    buffer_.sortedOrder(order_);
+    std::size_t bucket = 0;
+    for (std::size_t k = 0; k < order_.size();) {
+        const std::uint32_t first = order_[k];
+        const std::size_t b = buffer_.partition(first);
+        const std::string_view key = buffer_.key(first);
+        int total = buffer_.count(first);
+        for (++k; k < order_.size() && buffer_.partition(order_[k]) == b &&
+                  buffer_.key(order_[k]) == key; ++k) {
+            total = combine(key, total, buffer_.count(order_[k]));
+        }
+        if (b != bucket && !run_.empty()) {
+            files_->appendRun(bucket, run_.data());
+            run_.clear();
+        }
+        bucket = b;
+        run_.add(key, total);
+    }
+    if (!run_.empty()) {
+        files_->appendRun(bucket, run_.data());
+        run_.clear();
+    }
+    buffer_.clear();
+}
 
-        fileManager_.appendLine(path, word + "\t" + std::to_string(count));
+void Mapper::exportRecord(std::size_t bucket, std::string_view word, int count) {
+    RecordBuffer& block = blocks_[bucket];
+    block.add(word, count);
+    if (block.size() >= kBlockBytes) {
+        files_->append(bucket, block.data());
+        block.clear();
     }
+}
 
-    buffer_.clear();
+void Mapper::pushBlocks() {
+    for (std::size_t b = 0; b < blocks_.size(); ++b) {
+        files_->append(b, blocks_[b].data());
+        blocks_[b].clear();
+    }
 }
 
 } // namespace mr
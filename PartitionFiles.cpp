@@ -0,0 +1,83 @@
+#include "mr/PartitionFiles.hpp"
+
+namespace mr {
+
+std::string runIndexPath(const std::string& partitionPath) {
+    return partitionPath + ".runs";
+}
+
+std::vector<InputSplit> readRunIndex(const std::string& partitionPath) {
+    std::vector<InputSplit> runs;
+    std::ifstream in(runIndexPath(partitionPath));
+    std::string line;
+    while (std::getline(in, line)) {
+        InputSplit r;
+        if (parseSplit(partitionPath + "\t" + line, r) && !r.isWholeFile()) runs.push_back(std::move(r));
+    }
+    return runs;
+}
+
+PartitionFiles::PartitionFiles(FileManager& fm, const std::string& tempDir,
+                               int mapperId, int numReducers)
+    : fm_(fm), mapperId_(mapperId) {
+    const int n = numReducers > 0 ? numReducers : 1;
+
+    // File names: tempDir/m<mapperId>_r<bucket>.txt, built once
+    paths_.reserve(n);
+    for (int r = 0; r < n; ++r) {
+        paths_.push_back(tempDir + "/m" + std::to_string(mapperId) +
+                         "_r" + std::to_string(r) + ".txt");
+    }
+    sinks_.resize(n);
+    locks_.reset(new std::mutex[n]);
+    written_.assign(n, 0);
+    runs_.resize(n);
+    runsDirty_.assign(n, 0);
+}
+
+AppendSink& PartitionFiles::sinkFor(std::size_t bucket) {
+    AppendSink& sink = sinks_[bucket];
+    if (!sink.isOpen()) {
+        // First use in this job: drop whatever an earlier run of this
+        // mapper left (records and run index); later blocks append
+        fm_.removeFile(runIndexPath(paths_[bucket]));
+        written_[bucket] = 0;
+        sink = fm_.openAppend(paths_[bucket], /*truncate*/ true, kSinkBufferBytes);
+    }
+    return sink;
+}
+
+void PartitionFiles::append(std::size_t bucket, std::string_view block) {
+    if (block.empty()) return;
+    std::lock_guard<std::mutex> lk(locks_[bucket]);
+    sinkFor(bucket).write(block);
+    written_[bucket] += block.size();
+}
+
+void PartitionFiles::appendRun(std::size_t bucket, std::string_view run) {
+    if (run.empty()) return;
+    std::lock_guard<std::mutex> lk(locks_[bucket]);
+    sinkFor(bucket).write(run);
+    runs_[bucket].push_back(InputSplit{ paths_[bucket], written_[bucket], run.size() });
+    written_[bucket] += run.size();
+    runsDirty_[bucket] = 1;
+}
+
+void PartitionFiles::writeRunIndex(std::size_t bucket) {
+    std::string index;
+    for (const auto& r : runs_[bucket]) {
+        index += std::to_string(r.offset) + "\t" + std::to_string(r.length) + "\n";
+    }
+    fm_.writeAll(runIndexPath(paths_[bucket]), index);
+    runsDirty_[bucket] = 0;
+}
+
+void PartitionFiles::flush() {
+    for (std::size_t b = 0; b < sinks_.size(); ++b) {
+        std::lock_guard<std::mutex> lk(locks_[b]);
+        sinkFor(b).flush();   // also empties buckets this job never wrote to
+        if (runsDirty_[b]) writeRunIndex(b);
+    }
+}
+
+} // namespace mr
@@ -0,0 +1,140 @@
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#include "mr/PartitionStreams.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+
+#pragma comment(lib, "Ws2_32.lib")
+
+namespace mr {
+
+std::vector<std::pair<std::string, int>> parseEndpoints(const std::string& csv) {
+    std::vector<std::pair<std::string, int>> out;
+    std::size_t pos = 0;
+    while (pos < csv.size()) {
+        std::size_t end = csv.find(',', pos);
+        if (end == std::string::npos) end = csv.size();
+        const std::string spec = csv.substr(pos, end - pos);
+        const std::size_t colon = spec.rfind(':');
+        if (colon != std::string::npos)
+            out.emplace_back(spec.substr(0, colon), std::atoi(spec.c_str() + colon + 1));
+        pos = end + 1;
+    }
+    return out;
+}
+
+static bool sendAll(SOCKET s, const char* data, std::size_t len) {
+    while (len > 0) {
+        const int chunk = static_cast<int>(len < (1u << 30) ? len : (1u << 30));
+        const int n = send(s, data, chunk, 0);
+        if (n <= 0) return false;
+        data += n;
+        len -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+static bool recvAll(SOCKET s, char* data, std::size_t len) {
+    while (len > 0) {
+        const int chunk = static_cast<int>(len < (1u << 30) ? len : (1u << 30));
+        const int n = recv(s, data, chunk, 0);
+        if (n <= 0) return false;
+        data += n;
+        len -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool sendFrame(SOCKET s, std::string_view payload) {
+    const std::uint32_t n = static_cast<std::uint32_t>(payload.size());
+    const unsigned char header[4] = {
+        static_cast<unsigned char>(n >> 24), static_cast<unsigned char>(n >> 16),
+        static_cast<unsigned char>(n >> 8),  static_cast<unsigned char>(n) };
+    return sendAll(s, reinterpret_cast<const char*>(header), sizeof(header)) &&
+           sendAll(s, payload.data(), payload.size());
+}
+
+bool recvFrame(SOCKET s, std::string& payload) {
+    unsigned char header[4];
+    if (!recvAll(s, reinterpret_cast<char*>(header), sizeof(header))) return false;
+    const std::uint32_t n = (std::uint32_t(header[0]) << 24) | (std::uint32_t(header[1]) << 16) |
+                            (std::uint32_t(header[2]) << 8)  |  std::uint32_t(header[3]);
+    payload.resize(n);
+    return n == 0 || recvAll(s, &payload[0], n);
+}
+
+static SOCKET connectTo(const std::string& host, int port) {
+    addrinfo hints{}, *res = nullptr;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    const std::string portStr = std::to_string(port);
+    if (getaddrinfo(host.c_str(), portStr.c_str(), &hints, &res) != 0) return INVALID_SOCKET;
+
+    SOCKET s = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (s != INVALID_SOCKET && connect(s, res->ai_addr, (int)res->ai_addrlen) == SOCKET_ERROR) {
+        closesocket(s);
+        s = INVALID_SOCKET;
+    }
+    freeaddrinfo(res);
+    return s;
+}
+
+PartitionStreams::PartitionStreams(int mapperId,
+                                   const std::vector<std::pair<std::string, int>>& reducers)
+    : mapperId_(mapperId) {
+    WSADATA wsa{};
+    if (WSAStartup(MAKEWORD(2,2), &wsa) != 0)
+        throw std::runtime_error("PartitionStreams: WSAStartup failed");
+
+    const std::string hello = kPushHello + std::to_string(mapperId) + "\n";
+    for (const auto& [host, port] : reducers) {
+        SOCKET s = connectTo(host, port);
+        if (s == INVALID_SOCKET || !sendAll(s, hello.data(), hello.size())) {
+            if (s != INVALID_SOCKET) closesocket(s);
+            closeAll();
+            WSACleanup();
+            throw std::runtime_error("PartitionStreams: cannot reach reducer " + host + ":" +
+                                     std::to_string(port));
+        }
+        sockets_.push_back(s);
+    }
+    locks_.reset(new std::mutex[sockets_.size()]);
+}
+
+PartitionStreams::~PartitionStreams() {
+    closeAll();
+    WSACleanup();
+}
+
+void PartitionStreams::append(std::size_t bucket, std::string_view block) {
+    if (block.empty() || broken_) return;
+    std::lock_guard<std::mutex> lk(locks_[bucket]);
+    if (!sendFrame(sockets_[bucket], block) && !broken_.exchange(true))
+        throw std::runtime_error("PartitionStreams: reducer " + std::to_string(bucket) +
+                                 " closed the connection");
+}
+
+void PartitionStreams::finish() {
+    if (broken_) throw std::runtime_error("PartitionStreams: stream broken before the end");
+    for (std::size_t b = 0; b < sockets_.size(); ++b) {
+        std::lock_guard<std::mutex> lk(locks_[b]);
+        if (!sendFrame(sockets_[b], std::string_view()))
+            throw std::runtime_error("PartitionStreams: reducer " + std::to_string(b) +
+                                     " closed the connection");
+        shutdown(sockets_[b], SD_SEND);
+    }
+    closeAll();
+}
+
+void PartitionStreams::closeAll() {
+    for (SOCKET s : sockets_) closesocket(s);
+    sockets_.clear();
+}
+
+} // namespace mr
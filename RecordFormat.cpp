@@ -0,0 +1,211 @@
+#include "mr/RecordFormat.hpp"
+#include "mr/FileManager.hpp"
+
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace mr {
+
+static constexpr char kBlockMagic[3] = { '\0', 'M', 'R' };
+
+RecordFormat intermediateFormat() {
+    static const RecordFormat format = [] {
+        const char* v = std::getenv("MR_INTERMEDIATE_FORMAT");
+        return (v && std::string(v) == "text") ? RecordFormat::Text : RecordFormat::Binary;
+    }();
+    return format;
+}
+
+bool parseRecord(std::string_view line, std::string_view& word, int& count) {
+    std::size_t sep = line.find('\t');
+    if (sep == std::string_view::npos) sep = line.find(' ');
+    if (sep == std::string_view::npos) return false;
+
+    word = line.substr(0, sep);
+    const std::string_view num = line.substr(sep + 1);
+    count = 0;
+    std::from_chars(num.data(), num.data() + num.size(), count);
+    return !word.empty() && count != 0;
+}
+
+// ------------------------- varints -------------------------
+static void putVarint(std::string& out, std::uint64_t v) {
+    char buf[10];
+    std::size_t n = 0;
+    while (v >= 0x80) {
+        buf[n++] = static_cast<char>(v | 0x80);
+        v >>= 7;
+    }
+    buf[n++] = static_cast<char>(v);
+    out.append(buf, n);
+}
+
+static bool getVarint(const char*& p, const char* end, std::uint64_t& v) {
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        const auto b = static_cast<unsigned char>(*p++);
+        v |= std::uint64_t(b & 0x7F) << shift;
+        if (b < 0x80) return true;
+    }
+    return false;
+}
+
+static void putU32(char* out, std::uint32_t v) {
+    for (int i = 0; i < 4; ++i) out[i] = static_cast<char>(v >> (8 * i));
+}
+
+static std::uint32_t getU32(const char* in) {
+    std::uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= std::uint32_t(static_cast<unsigned char>(in[i])) << (8 * i);
+    return v;
+}
+
+// ------------------------- RecordBuffer -------------------------
+void RecordBuffer::add(std::string_view key, long long count) {
+    if (format_ == RecordFormat::Text) {
+        appendRecord(bytes_, key, count);
+        return;
+    }
+
+    if (blockStart_ != kNoBlock &&
+        bytes_.size() - blockStart_ - kBlockHeaderBytes >= kBlockPayloadBytes) {
+        closeBlock();
+    }
+    if (blockStart_ == kNoBlock) {
+        blockStart_ = bytes_.size();
+        bytes_.append(kBlockHeaderBytes, '\0'); // filled in by closeBlock()
+        blockRecords_ = 0;
+        prevKey_.clear();
+    }
+
+    if (frontCoded_) {
+        std::size_t shared = 0;
+        const std::size_t maxShared = std::min(prevKey_.size(), key.size());
+        while (shared < maxShared && prevKey_[shared] == key[shared]) ++shared;
+        putVarint(bytes_, shared);
+        putVarint(bytes_, key.size() - shared);
+        bytes_.append(key.data() + shared, key.size() - shared);
+        prevKey_.assign(key.data(), key.size());
+    } else {
+        putVarint(bytes_, key.size());
+        bytes_.append(key.data(), key.size());
+    }
+    putVarint(bytes_, static_cast<std::uint64_t>(count));
+    ++blockRecords_;
+}
+
+void RecordBuffer::closeBlock() {
+    if (blockStart_ == kNoBlock) return;
+    char* h = &bytes_[blockStart_];
+    std::memcpy(h, kBlockMagic, sizeof(kBlockMagic));
+    h[3] = static_cast<char>(frontCoded_ ? kFrontCoded : 0);
+    putU32(h + 4, blockRecords_);
+    putU32(h + 8, static_cast<std::uint32_t>(bytes_.size() - blockStart_ - kBlockHeaderBytes));
+    blockStart_ = kNoBlock;
+}
+
+std::string_view RecordBuffer::data() {
+    closeBlock();
+    return bytes_;
+}
+
+void RecordBuffer::clear() {
+    bytes_.clear();
+    blockStart_ = kNoBlock;
+    prevKey_.clear();
+}
+
+// ------------------------- BlockDecoder -------------------------
+bool BlockDecoder::readHeader(std::string_view header, std::uint8_t& flags,
+                              std::uint32_t& records, std::uint32_t& payloadBytes) {
+    if (header.size() < kBlockHeaderBytes ||
+        std::memcmp(header.data(), kBlockMagic, sizeof(kBlockMagic)) != 0) return false;
+    flags        = static_cast<std::uint8_t>(header[3]);
+    records      = getU32(header.data() + 4);
+    payloadBytes = getU32(header.data() + 8);
+    return true;
+}
+
+void BlockDecoder::reset(std::string_view payload, std::uint32_t records, std::uint8_t flags) {
+    p_          = payload.data();
+    end_        = payload.data() + payload.size();
+    left_       = records;
+    frontCoded_ = (flags & kFrontCoded) != 0;
+    key_.clear();
+}
+
+bool BlockDecoder::next(std::string_view& key, int& count) {
+    if (left_ == 0) return false;
+
+    std::uint64_t shared = 0, len = 0, value = 0;
+    if (frontCoded_ && !getVarint(p_, end_, shared)) throw std::runtime_error("corrupt intermediate block");
+    if (!getVarint(p_, end_, len) || len > static_cast<std::uint64_t>(end_ - p_) ||
+        shared > key_.size()) {
+        throw std::runtime_error("corrupt intermediate block");
+    }
+    if (frontCoded_) {
+        key_.resize(static_cast<std::size_t>(shared));
+        key_.append(p_, static_cast<std::size_t>(len));
+        key = key_;
+    } else {
+        key = std::string_view(p_, static_cast<std::size_t>(len));
+    }
+    p_ += len;
+    if (!getVarint(p_, end_, value)) throw std::runtime_error("corrupt intermediate block");
+    count = static_cast<int>(static_cast<std::uint32_t>(value));
+    --left_;
+    return true;
+}
+
+// ------------------------- RecordReader -------------------------
+// Binary data starts with a block header, text never with a NUL byte
+static RecordFormat detectFormat(const InputSplit& range) {
+    std::ifstream in(range.path, std::ios::binary);
+    in.seekg(static_cast<std::streamoff>(range.offset));
+    const int c = in.get();
+    return c == 0 ? RecordFormat::Binary : RecordFormat::Text;
+}
+
+// Binary ranges are exact block boundaries: read them raw from offset 0
+// up to the range end and seek, instead of aligning to lines
+static std::uint64_t readerLength(const InputSplit& r, RecordFormat f) {
+    if (f == RecordFormat::Text || r.length == InputSplit::kWholeFile) return r.length;
+    return r.offset + r.length;
+}
+
+RecordReader::RecordReader(const InputSplit& range, std::size_t windowBytes)
+    : path_(range.path),
+      format_(detectFormat(range)),
+      reader_(range.path, format_ == RecordFormat::Text ? range.offset : 0,
+              readerLength(range, format_), windowBytes) {
+    if (format_ == RecordFormat::Binary) reader_.seek(range.offset);
+}
+
+bool RecordReader::next(std::string_view& key, int& count) {
+    if (format_ == RecordFormat::Text) {
+        std::string_view line;
+        while (reader_.next(line)) {
+            if (parseRecord(line, key, count)) return true;
+        }
+        return false;
+    }
+
+    while (!block_.next(key, count)) {
+        std::string_view header, payload;
+        if (!reader_.read(kBlockHeaderBytes, header)) return false;
+
+        std::uint8_t flags = 0;
+        std::uint32_t records = 0, payloadBytes = 0;
+        if (!BlockDecoder::readHeader(header, flags, records, payloadBytes) ||
+            !reader_.read(payloadBytes, payload)) {
+            throw std::runtime_error("corrupt intermediate file: " + path_);
+        }
+        block_.reset(payload, records, flags);
+    }
+    return true;
+}
+
+} // namespace mr
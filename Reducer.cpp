@@ -19,7 +19,13 @@ Reducer::Reducer(FileManager& fm, const std::string& outputDir)
     const std::string suffix = envOrEmpty("MR_OUTFILE_SUFFIX");
     outFilePath_ = outputDir_ + "/word_counts" + suffix + ".txt";
 
-    fileManager_.writeAll(outFilePath_, "");
+    out_ = fileManager_.openAppend(outFilePath_, /*truncate*/ true);
+}
+
+Reducer::Reducer(FileManager& fm, const std::string& outputDir, const std::string& fileName)
+    : fileManager_(fm), outputDir_(outputDir), outFilePath_(outputDir + "/" + fileName) {
+    fileManager_.ensureDir(outputDir_);
+    out_ = fileManager_.openAppend(outFilePath_, /*truncate*/ true);
 }
 
 void Reducer::reduce(const Word& word, const std::vector<Count>& counts) {
@@ -27,11 +33,24 @@ void Reducer::reduce(const Word& word, const std::vector<Count>& counts) {
     exportResult(word, total);
 }
 
+void Reducer::reduce(const Word& word, IValueStream& values) {
+    int total = 0;
+    for (int v = 0; values.next(v); ) total += v;
+    exportResult(word, total);
+}
+
 void Reducer::exportResult(const Word& word, int total) {
-    fileManager_.appendLine(outFilePath_, word + "\t" + std::to_string(total));
+    out_.writeRecord(word, total);
+}
+
+void Reducer::flush() {
+    out_.flush();
 }
 
 void Reducer::markSuccess() {
+    // Results must be on disk before the marker announces them
+    out_.flush();
+
     const std::string suffix = envOrEmpty("MR_OUTFILE_SUFFIX");
     const std::string successPath =
         outputDir_ + (suffix.empty() ? "/SUCCESS" : ("/SUCCESS" + suffix));
@@ -0,0 +1,29 @@
+#include "mr/RunMerge.hpp"
+
+namespace mr {
+
+bool RunMerge::Cursor::advance() {
+    return reader->next(word, count);
+}
+
+static std::vector<InputSplit> wholeFiles(const std::vector<std::string>& paths) {
+    std::vector<InputSplit> runs;
+    runs.reserve(paths.size());
+    for (const auto& p : paths) runs.push_back(InputSplit{ p });
+    return runs;
+}
+
+RunMerge::RunMerge(const std::vector<std::string>& runs, std::size_t windowBytes)
+    : RunMerge(wholeFiles(runs), windowBytes) {}
+
+RunMerge::RunMerge(const std::vector<InputSplit>& runs, std::size_t windowBytes)
+    : cursors_(runs.size()), tree_(runs.size(), CursorLess{ &cursors_ }) {
+    std::vector<bool> exhausted(runs.size());
+    for (std::size_t i = 0; i < runs.size(); ++i) {
+        cursors_[i].reader = std::make_unique<RecordReader>(runs[i], windowBytes);
+        exhausted[i] = !cursors_[i].advance();
+    }
+    tree_.build(exhausted);
+}
+
+} // namespace mr
@@ -0,0 +1,212 @@
+#include "mr/Tokenizer.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+  #define MR_TOKENIZER_X86 1
+  #include <immintrin.h>
+  #if defined(_MSC_VER) && !defined(__clang__)
+    #include <intrin.h>
+    #define MR_TARGET(x)
+  #else
+    #define MR_TARGET(x) __attribute__((target(x)))
+  #endif
+#endif
+
+namespace mr {
+
+namespace {
+
+using FoldFn = Tokenizer::FoldFn;
+
+inline bool isLetter(unsigned char c) {
+    return static_cast<unsigned char>((c | 0x20) - 'a') < 26;
+}
+
+// Scalar fold of [from, n); from must be a multiple of 64
+void foldScalarFrom(const char* src, char* dst, std::uint64_t* mask,
+                    std::size_t from, std::size_t n) {
+    for (std::size_t w = from; w < n; w += 64) {
+        const std::size_t end = std::min(n, w + 64);
+        std::uint64_t bits = 0;
+        for (std::size_t i = w; i < end; ++i) {
+            const unsigned char uc = static_cast<unsigned char>(src[i]);
+            if (isLetter(uc)) {
+                dst[i] = static_cast<char>(uc | 0x20);
+                bits |= std::uint64_t(1) << (i - w);
+            } else {
+                dst[i] = ' ';
+            }
+        }
+        mask[w / 64] = bits;
+    }
+}
+
+void foldScalar(const char* src, char* dst, std::uint64_t* mask, std::size_t n) {
+    foldScalarFrom(src, dst, mask, 0, n);
+}
+
+#ifdef MR_TOKENIZER_X86
+// Letter test for every lane: t = (c | 0x20) - 'a' is a letter iff t <= 25
+// as an unsigned byte, i.e. min(t, 25) == t.
+
+void foldSse2(const char* src, char* dst, std::uint64_t* mask, std::size_t n) {
+    const __m128i k20 = _mm_set1_epi8(0x20);
+    const __m128i kA  = _mm_set1_epi8('a');
+    const __m128i k25 = _mm_set1_epi8(25);
+    const __m128i kSp = _mm_set1_epi8(' ');
+
+    std::size_t w = 0;
+    for (; w + 64 <= n; w += 64) {
+        std::uint64_t bits = 0;
+        for (int j = 0; j < 4; ++j) {
+            const __m128i v  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + w + 16 * j));
+            const __m128i lc = _mm_or_si128(v, k20);
+            const __m128i t  = _mm_sub_epi8(lc, kA);
+            const __m128i m  = _mm_cmpeq_epi8(_mm_min_epu8(t, k25), t);
+            const __m128i o  = _mm_or_si128(_mm_and_si128(m, lc), _mm_andnot_si128(m, kSp));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + w + 16 * j), o);
+            bits |= std::uint64_t(static_cast<std::uint16_t>(_mm_movemask_epi8(m))) << (16 * j);
+        }
+        mask[w / 64] = bits;
+    }
+    foldScalarFrom(src, dst, mask, w, n);
+}
+
+MR_TARGET("avx2")
+void foldAvx2(const char* src, char* dst, std::uint64_t* mask, std::size_t n) {
+    const __m256i k20 = _mm256_set1_epi8(0x20);
+    const __m256i kA  = _mm256_set1_epi8('a');
+    const __m256i k25 = _mm256_set1_epi8(25);
+    const __m256i kSp = _mm256_set1_epi8(' ');
+
+    std::size_t w = 0;
+    for (; w + 64 <= n; w += 64) {
+        std::uint64_t bits = 0;
+        for (int j = 0; j < 2; ++j) {
+            const __m256i v  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + w + 32 * j));
+            const __m256i lc = _mm256_or_si256(v, k20);
+            const __m256i t  = _mm256_sub_epi8(lc, kA);
+            const __m256i m  = _mm256_cmpeq_epi8(_mm256_min_epu8(t, k25), t);
+            const __m256i o  = _mm256_blendv_epi8(kSp, lc, m);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + w + 32 * j), o);
+            bits |= std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(m))) << (32 * j);
+        }
+        mask[w / 64] = bits;
+    }
+    foldScalarFrom(src, dst, mask, w, n);
+}
+
+MR_TARGET("avx512f,avx512bw")
+void foldAvx512(const char* src, char* dst, std::uint64_t* mask, std::size_t n) {
+    const __m512i k20 = _mm512_set1_epi8(0x20);
+    const __m512i kA  = _mm512_set1_epi8('a');
+    const __m512i k25 = _mm512_set1_epi8(25);
+    const __m512i kSp = _mm512_set1_epi8(' ');
+
+    std::size_t w = 0;
+    for (; w + 64 <= n; w += 64) {
+        const __m512i  v  = _mm512_loadu_si512(src + w);
+        const __m512i  lc = _mm512_or_si512(v, k20);
+        const __m512i  t  = _mm512_sub_epi8(lc, kA);
+        const __mmask64 m = _mm512_cmple_epu8_mask(t, k25);
+        _mm512_storeu_si512(dst + w, _mm512_mask_blend_epi8(m, kSp, lc));
+        mask[w / 64] = static_cast<std::uint64_t>(m);
+    }
+    foldScalarFrom(src, dst, mask, w, n);
+}
+
+struct CpuFeatures { bool avx2 = false; bool avx512bw = false; };
+
+CpuFeatures detectCpu() {
+    CpuFeatures f;
+#if defined(_MSC_VER) && !defined(__clang__)
+    int r[4];
+    __cpuid(r, 0);
+    if (r[0] < 7) return f;
+    __cpuid(r, 1);
+    const bool osxsave = (r[2] & (1 << 27)) != 0;
+    const bool avx     = (r[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx) return f;
+    const unsigned long long xcr0 = _xgetbv(0);
+    if ((xcr0 & 0x6) != 0x6) return f;              // XMM + YMM state
+    __cpuidex(r, 7, 0);
+    f.avx2 = (r[1] & (1 << 5)) != 0;
+    f.avx512bw = (r[1] & (1 << 16)) && (r[1] & (1 << 30)) &&
+                 (xcr0 & 0xE0) == 0xE0;             // opmask + ZMM state
+#else
+    __builtin_cpu_init();
+    f.avx2     = __builtin_cpu_supports("avx2");
+    f.avx512bw = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+    return f;
+}
+#endif // MR_TOKENIZER_X86
+
+struct Kernel {
+    FoldFn      fn;
+    const char* name;
+};
+
+// Kernels this build and CPU can run, fastest first
+std::vector<Kernel> supportedKernels() {
+    std::vector<Kernel> kernels;
+#ifdef MR_TOKENIZER_X86
+    const CpuFeatures cpu = detectCpu();
+    if (cpu.avx512bw) kernels.push_back({ foldAvx512, "avx512" });
+    if (cpu.avx2)     kernels.push_back({ foldAvx2, "avx2" });
+    kernels.push_back({ foldSse2, "sse2" });
+#endif
+    kernels.push_back({ foldScalar, "scalar" });
+    return kernels;
+}
+
+// MR_SIMD=<name> if this CPU can run it, else the fastest kernel
+Kernel selectKernel() {
+    const std::vector<Kernel> kernels = supportedKernels();
+    if (const char* want = std::getenv("MR_SIMD")) {
+        for (const Kernel& k : kernels) {
+            if (std::strcmp(k.name, want) == 0) return k;
+        }
+    }
+    return kernels.front();
+}
+
+const Kernel& kernel() {
+    static const Kernel k = selectKernel();
+    return k;
+}
+
+} // namespace
+
+Tokenizer::Tokenizer() : fold_(kernel().fn) {}
+
+Tokenizer::Tokenizer(std::string_view kernelName) : fold_(nullptr) {
+    for (const Kernel& k : supportedKernels()) {
+        if (kernelName == k.name) fold_ = k.fn;
+    }
+    if (!fold_) {
+        throw std::invalid_argument("Tokenizer kernel not available: " + std::string(kernelName));
+    }
+}
+
+std::vector<std::string> Tokenizer::availableKernels() {
+    std::vector<std::string> names;
+    for (const Kernel& k : supportedKernels()) names.emplace_back(k.name);
+    return names;
+}
+
+void Tokenizer::fold(const char* src, char* dst, std::uint64_t* letterMask, std::size_t n) {
+    kernel().fn(src, dst, letterMask, n);
+}
+
+const char* Tokenizer::kernelName() {
+    return kernel().name;
+}
+
+} // namespace mr
@@ -1,16 +1,29 @@
 #include "mr/Workflow.hpp"
+#include "mr/ExternalSorter.hpp"
 #include "mr/Mapper.hpp"
 #include "mr/Reducer.hpp"
 #include "mr/FileManager.hpp"
+#include "mr/InputSplit.hpp"
+#include "mr/LineReader.hpp"
+#include "mr/PartitionFiles.hpp"
+#include "mr/RunMerge.hpp"
 #include "mr/Types.hpp"
 
-#include <map>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <string>
 #include <vector>
 #include <stdexcept>
 #include <sstream>
 #include <cstddef>
+#include <cstdint>
 
 // ---------- Phase-2 (DLL plugins) headers are optional ----------
 // Enable by defining MR_PHASE2_AVAILABLE via CMake if/when you need it.
@@ -18,13 +31,40 @@
 //   target_compile_definitions(mapreduce_gui PRIVATE MR_PHASE2_AVAILABLE)
 #ifdef MR_PHASE2_AVAILABLE
   #include "mr/Interfaces.hpp"      // mr::IMapper, mr::IReducer, factory symbols
-  #include "mr/PluginLoader.hpp"    // loadPlugins / freePlugins
+  #include "mr/PluginCache.hpp"     // PluginCache / PluginSet (loader in PluginLoader.hpp)
   #include "mr/PluginContexts.hpp"  // MapContextAdapter / ReduceContextAdapter
 #endif
 
 namespace mr {
 
 // ------------------------- ctor -------------------------
+static std::size_t sortMemoryFromEnv() {
+    const char* v = std::getenv("MR_SORT_MB");
+    const long long mb = v ? std::atoll(v) : 0;
+    return mb > 0 ? static_cast<std::size_t>(mb) << 20 : ExternalSorter::kDefaultMemoryBytes;
+}
+
+// Runs body on n threads (the caller is one of them); the first exception
+// thrown by any of them is rethrown once all have finished.
+static void runOnThreads(unsigned n, const std::function<void()>& body) {
+    std::exception_ptr error;
+    std::mutex         errorMu;
+    auto guarded = [&] {
+        try {
+            body();
+        } catch (...) {
+            std::lock_guard<std::mutex> lk(errorMu);
+            if (!error) error = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < n; ++t) pool.emplace_back(guarded);
+    guarded();
+    for (auto& th : pool) th.join();
+    if (error) std::rethrow_exception(error);
+}
+
 Workflow::Workflow(FileManager& fm,
                    const std::string& inputDir,
                    const std::string& tempDir,
@@ -32,157 +72,279 @@ Workflow::Workflow(FileManager& fm,
     : fileManager_(fm),
       inputDir_(inputDir),
       tempDir_(tempDir),
-      outputDir_(outputDir) {
+      outputDir_(outputDir),
+      sortMemoryBytes_(sortMemoryFromEnv()),
+      numThreads_(mapThreadsFromEnv()) {
     fileManager_.ensureDir(tempDir_);
     fileManager_.ensureDir(outputDir_);
 }
 
+void Workflow::setSortMemoryLimit(std::size_t bytes) {
+    sortMemoryBytes_ = bytes ? bytes : ExternalSorter::kDefaultMemoryBytes;
+}
+
+void Workflow::setThreads(unsigned threads) {
+    numThreads_ = threads ? threads : 1;
+}
+
 // -------------------- Phase-1 entrypoint -----------------
 void Workflow::run() {
-    doMapPhase();
-    Grouped grouped = doSortAndGroup();
-    doReducePhase(grouped);
+    runBuiltin(nullptr);
 }
 
-// ------------- Phase-1: Map (to temp/intermediate.txt) -------------
-void Workflow::doMapPhase() {
-    const std::string tmpFile = tempDir_ + "/intermediate.txt";
-    // Clear previous intermediate output
-    fileManager_.writeAll(tmpFile, "");
+void Workflow::runBuiltin(std::vector<std::pair<std::string, int>>* counts) {
+    const auto shards  = doMapPhase();
+    const auto reduced = reduceShards(shards);
 
-    // Tuneable flush threshold
-    Mapper mapper(fileManager_, tempDir_, /*flushThreshold=*/2048);
-
-    const auto files = fileManager_.listFiles(inputDir_);
-    for (const auto& path : files) {
-        const auto lines = fileManager_.readAllLines(path);
-        for (const auto& line : lines) {
-            mapper.map(path, line);
-        }
+    // Shards hold disjoint word sets, each sorted: one merge yields the
+    // globally sorted output
+    Reducer reducer(fileManager_, outputDir_);
+    std::string word;
+    for (RunMerge merge(reduced); merge.valid(); merge.pop()) {
+        word.assign(merge.word().data(), merge.word().size());
+        reducer.exportResult(word, merge.count());
+        if (counts) counts->emplace_back(word, merge.count());
     }
-    mapper.flush();
+    reducer.markSuccess();
+
+    for (const auto& path : reduced) fileManager_.removeFile(path);
 }
 
-// -------- Phase-1: Sort & Group (word -> [1,1,...]) --------
-Workflow::Grouped Workflow::doSortAndGroup() {
-    Grouped grouped;
-    const std::string tmpFile = tempDir_ + "/intermediate.txt";
-    if (!fileManager_.exists(tmpFile)) {
-        return grouped;
-    }
+// ------------- Phase-1: Map (to temp/m0_r<shard>.txt) -------------
+// Input files are cut into chunks that numThreads_ Mappers pull from a
+// shared counter; pairs are hash-partitioned into one file per shard.
+std::vector<std::string> Workflow::doMapPhase() {
+    const unsigned numShards = numThreads_;
+    auto files = std::make_shared<PartitionFiles>(fileManager_, tempDir_, /*mapperId*/ 0,
+                                                  static_cast<int>(numShards));
+    // PartitionFiles truncates each shard file on first use, so a previous
+    // run's intermediate output is never read back
+    std::vector<std::string> shards;
+    for (unsigned s = 0; s < numShards; ++s) shards.push_back(files->path(s));
+
+    const std::vector<InputSplit> work = chunkFiles(fileManager_.listFiles(inputDir_));
+    const unsigned numMappers =
+        static_cast<unsigned>(std::max<std::size_t>(1, std::min<std::size_t>(numThreads_, work.size())));
+
+    std::atomic<std::size_t> nextChunk{ 0 };
+    runOnThreads(numMappers, [&] {
+        // Tuneable flush threshold; words are pre-summed in memory before export
+        Mapper mapper(fileManager_, files, /*flushThreshold=*/2048);
+        mapper.enableCombiner(Mapper::kDefaultCombineBudget / numMappers);
 
-    const auto lines = fileManager_.readAllLines(tmpFile);
-    for (const auto& line : lines) {
-        std::size_t tabPos = line.find('\t');
-        if (tabPos == std::string::npos) {
-            // also accept single-space separated fallback
-            const std::size_t sp = line.find(' ');
-            if (sp == std::string::npos) continue;
-
-            const std::string word = line.substr(0, sp);
-            int value = 0;
-            try { value = std::stoi(line.substr(sp + 1)); } catch (...) { value = 0; }
-            if (!word.empty() && value != 0) {
-                grouped[word].push_back(value);
+        for (std::size_t i; (i = nextChunk++) < work.size();) {
+            const auto& split = work[i];
+            LineReader reader(split.path, split.offset, split.length);
+            std::string_view line;
+            while (reader.next(line)) {
+                mapper.map(split.path, line);
             }
-            continue;
         }
+        mapper.flush();
+    });
+    files->flush();
+    return shards;
+}
 
-        const std::string word = line.substr(0, tabPos);
-        int value = 0;
-        try { value = std::stoi(line.substr(tabPos + 1)); } catch (...) { value = 0; }
-        if (!word.empty() && value != 0) {
-            grouped[word].push_back(value);
-        }
+// -------- Phase-1: Sort & Group (word -> [1,1,...]) --------
+// Pairs are fed to the external sorter, which keeps at most its share of
+// sortMemoryBytes_ in RAM and spills sorted runs to tempDir_; the groups
+// are produced later, in key order, by merging those runs.
+void Workflow::doSortAndGroup(const std::string& intermediatePath, ExternalSorter& sorter) {
+    if (!fileManager_.exists(intermediatePath)) {
+        return;
     }
-    return grouped;
+    sorter.addFile(intermediatePath);
 }
 
 // --------------------- Phase-1: Reduce ---------------------
-void Workflow::doReducePhase(const Grouped& grouped) {
-    Reducer reducer(fileManager_, outputDir_);
-    for (const auto& kv : grouped) {
-        reducer.reduce(kv.first, kv.second);
-    }
-    reducer.markSuccess();
+void Workflow::doReducePhase(ExternalSorter& sorter, Reducer& reducer) {
+    sorter.forEachGroupStream([&reducer](const std::string& word, IValueStream& counts) {
+        reducer.reduce(word, counts);
+    });
 }
 
-// ------------- Convenience: run and return counts ----------
-std::vector<std::pair<std::string, int>> Workflow::runAndGetCounts() {
-    doMapPhase();
-    Grouped grouped = doSortAndGroup();
-
-    std::map<std::string, int> totals;
-    for (const auto& kv : grouped) {
-        int sum = 0;
-        for (int v : kv.second) sum += v;
-        totals[kv.first] = sum;
-    }
+// Every shard is sorted, grouped and reduced on its own thread into a
+// key-sorted temp file; returns those files in shard order.
+std::vector<std::string> Workflow::reduceShards(const std::vector<std::string>& shards) {
+    std::vector<std::string> reduced(shards.size());
+    const unsigned numWorkers =
+        static_cast<unsigned>(std::max<std::size_t>(1, std::min<std::size_t>(numThreads_, shards.size())));
+    const std::size_t memoryPerShard = sortMemoryBytes_ / numWorkers;
 
-    // Write results like normal reduce, so files are consistent
-    Reducer reducer(fileManager_, outputDir_);
-    for (const auto& p : totals) {
-        std::vector<int> one{ p.second };
-        reducer.reduce(p.first, one);
-    }
-    reducer.markSuccess();
+    std::atomic<std::size_t> nextShard{ 0 };
+    runOnThreads(numWorkers, [&] {
+        for (std::size_t s; (s = nextShard++) < shards.size();) {
+            const std::string id = std::to_string(s);
+            ExternalSorter sorter(fileManager_, tempDir_ + "/sort_s" + id + "_", memoryPerShard);
+            sorter.combineBySum(); // builtin Reducer sums, so partial sums are enough
+            doSortAndGroup(shards[s], sorter);
+
+            Reducer reducer(fileManager_, tempDir_, "reduce_s" + id + ".txt");
+            doReducePhase(sorter, reducer);
+            reducer.flush();
+            reduced[s] = reducer.outputPath();
+        }
+    });
+    return reduced;
+}
 
+// ------------- Convenience: run and return counts ----------
+std::vector<std::pair<std::string, int>> Workflow::runAndGetCounts() {
+    // Results are written like a normal run, so files are consistent
     std::vector<std::pair<std::string, int>> out;
-    out.reserve(totals.size());
-    for (const auto& p : totals) out.emplace_back(p.first, p.second);
+    runBuiltin(&out);
     return out;
 }
 
 // ======================= Phase-2 path =======================
 // Dynamically load Map/Reduce from DLLs and run with contexts.
 // Keeps Phase-1 intact; you only use this when asked explicitly.
+#ifdef MR_PHASE2_AVAILABLE
+// Plugins and their instances stay loaded between the jobs of a
+// long-lived process (GUI, repeated runs) and reload when rebuilt
+static PluginCache& pluginCache() {
+    static PluginCache cache((std::filesystem::temp_directory_path() / "mr_plugins").string());
+    return cache;
+}
+
+// Bytes of lines handed to one IMapper::mapBatch call. LineReader views
+// die when its window moves, so a batch's lines are copied into one buffer.
+static constexpr std::size_t kMapBatchBytes = 1u << 20; // 1 MiB
+
+static void mapFileInBatches(const std::string& path, IMapper& mapper, IMapContext& ctx) {
+    LineReader reader(path);
+    std::string bytes;
+    std::vector<std::size_t> ends;          // end offset of each line in bytes
+    std::vector<std::string_view> lines;
+
+    auto dispatch = [&] {
+        lines.clear();
+        std::size_t begin = 0;
+        for (std::size_t end : ends) {
+            lines.emplace_back(bytes.data() + begin, end - begin);
+            begin = end;
+        }
+        mapper.mapBatch(path, lines.data(), lines.size(), ctx);
+        bytes.clear();
+        ends.clear();
+    };
+
+    std::string_view line;
+    while (reader.next(line)) {
+        bytes.append(line.data(), line.size());
+        ends.push_back(bytes.size());
+        if (bytes.size() >= kMapBatchBytes) dispatch();
+    }
+    if (!ends.empty()) dispatch();
+}
+#endif
+
 bool Workflow::runWithPlugins(const std::string& dllDir)
 {
 #ifndef MR_PHASE2_AVAILABLE
     (void)dllDir;
     throw std::runtime_error("Phase-2 plugins are not enabled in this build.");
 #else
-    // ----- Load user-specified Map/Reduce plugins -----
-    PluginHandles ph = loadPlugins(dllDir);
-
-    // Create mapper/reducer instances via factories with RAII cleanup
-    std::unique_ptr<IMapper, void(*)(IMapper*)> mapper(
-        ph.createMapper(), ph.destroyMapper);
-    std::unique_ptr<IReducer, void(*)(IReducer*)> reducer(
-        ph.createReducer(), ph.destroyReducer);
-
-    // ----- MAP via plugin -----
-    const std::string tmpFile = tempDir_ + "/intermediate.txt";
-    fileManager_.writeAll(tmpFile, ""); // clear any previous intermediate
-
-    MapContextAdapter mapCtx(fileManager_, tempDir_);
-
-    const auto files = fileManager_.listFiles(inputDir_);
-    for (const auto& path : files) {
-        const auto lines = fileManager_.readAllLines(path);
-        for (const auto& line : lines) {
-            mapper->map(path, line, mapCtx);
+    // ----- User-specified Map/Reduce plugins (loaded once per process) -----
+    const std::shared_ptr<PluginSet> plugins = pluginCache().acquire(dllDir);
+    const PluginHandles& ph = plugins->handles();
+    const std::shared_ptr<IMapper> mapper = plugins->leaseMapper();
+    const std::shared_ptr<ICombiner> mapCombiner = plugins->leaseCombiner(); // optional
+
+    // ----- MAP via plugin (to temp/m0_r<shard>.txt, as in Phase-1) -----
+    const unsigned numShards = numThreads_;
+    auto parts = std::make_shared<PartitionFiles>(fileManager_, tempDir_, /*mapperId*/ 0,
+                                                  static_cast<int>(numShards));
+    std::vector<std::string> shards;
+    for (unsigned s = 0; s < numShards; ++s) shards.push_back(parts->path(s));
+
+    {
+        MapContextAdapter mapCtx(fileManager_, parts);
+        if (mapCombiner) mapCtx.enableCombiner(*mapCombiner); // pre-aggregate before spilling
+
+        // IMapper::map takes std::string; reuse one buffer instead of one per line
+        std::string lineBuf;
+        const auto files = fileManager_.listFiles(inputDir_);
+        for (const auto& path : files) {
+            if (ph.mapAbi >= 3) {
+                mapFileInBatches(path, *mapper, mapCtx);
+                continue;
+            }
+            LineReader reader(path);
+            std::string_view line;
+            while (reader.next(line)) {
+                lineBuf.assign(line.data(), line.size());
+                mapper->map(path, lineBuf, mapCtx);
+            }
         }
+        mapper->flush(mapCtx);
+        mapCtx.flush(); // partition files are read back below
     }
-    mapper->flush(mapCtx);
 
-    // ----- SORT & GROUP (same as Phase-1) -----
-    Grouped grouped = doSortAndGroup();
+    // ----- SORT, GROUP & REDUCE every shard via plugin -----
+    // One reducer instance per worker thread; shard results are kept
+    // binary so any word or total survives the final merge unchanged.
+    std::vector<std::string> reduced(shards.size());
+    std::vector<char>        reducedSorted(shards.size(), 0);
+    const unsigned numWorkers =
+        static_cast<unsigned>(std::max<std::size_t>(1, std::min<std::size_t>(numThreads_, shards.size())));
+    const std::size_t memoryPerShard = sortMemoryBytes_ / numWorkers;
 
-    // ----- REDUCE via plugin -----
-    const std::string outFile = outputDir_ + "/word_counts.txt";
-    ReduceContextAdapter reduceCtx(fileManager_, outFile);
+    std::atomic<std::size_t> nextShard{ 0 };
+    runOnThreads(numWorkers, [&] {
+        const std::shared_ptr<IReducer>  reducer  = plugins->leaseReducer();
+        const std::shared_ptr<ICombiner> combiner = plugins->leaseCombiner();
 
-    for (auto& kv : grouped) {
-        reducer->reduce(kv.first, kv.second, reduceCtx);
-    }
+        for (std::size_t s; (s = nextShard++) < shards.size();) {
+            const std::string id = std::to_string(s);
+            ExternalSorter sorter(fileManager_, tempDir_ + "/sort_s" + id + "_", memoryPerShard);
+            if (combiner) {
+                // Values are folded as they are buffered and when runs merge
+                sorter.combineWith([&combiner](std::string_view w, int a, int b) {
+                    return combiner->combine(w, a, b);
+                });
+            }
+            doSortAndGroup(shards[s], sorter);
 
-    // Reuse Phase-1 success marker for consistency
-    Reducer builtin(fileManager_, outputDir_);
-    builtin.markSuccess();
+            ReduceContextAdapter reduceCtx(fileManager_, tempDir_ + "/reduce_s" + id + ".txt",
+                                           RecordFormat::Binary);
+            if (ph.reduceAbi >= 2) {
+                // Values stream from the merge; no per-word list is materialized
+                sorter.forEachGroupStream([&](const std::string& word, IValueStream& counts) {
+                    reducer->reduceStream(word, counts, reduceCtx);
+                });
+            } else {
+                // Plugins built before reduceStream existed only have reduce(vector)
+                sorter.forEachGroup([&](const std::string& word, const std::vector<Count>& counts) {
+                    reducer->reduce(word, counts, reduceCtx);
+                });
+            }
+            reduceCtx.flush();
+            reduced[s]       = reduceCtx.outputPath();
+            reducedSorted[s] = reduceCtx.sorted();
+        }
+    });
+
+    // Plugin reducers may emit any keys in any order (see IReducer). Shard
+    // outputs that came out in key order, the usual case, join the final
+    // merge as they are; the others are re-sorted first, so word_counts.txt
+    // is sorted by key either way. Equal keys keep every record.
+    {
+        ExternalSorter finalSort(fileManager_, tempDir_ + "/final_", sortMemoryBytes_);
+        for (std::size_t s = 0; s < reduced.size(); ++s) {
+            if (reducedSorted[s]) finalSort.addSortedRun(InputSplit{ reduced[s] });
+            else                  finalSort.addFile(reduced[s]);
+        }
+        AppendSink out = fileManager_.openAppend(outputDir_ + "/word_counts.txt", /*truncate*/ true);
+        finalSort.forEachGroupStream([&out](const std::string& word, IValueStream& totals) {
+            for (int total = 0; totals.next(total);) out.writeRecord(word, total);
+        });
+    }
+    for (const auto& path : reduced) fileManager_.removeFile(path);
 
-    // ----- Unload DLLs -----
-    freePlugins(ph);
+    // Same SUCCESS marker as Phase-1 (a builtin Reducer would truncate the output)
+    fileManager_.writeEmptyFile(outputDir_ + "/SUCCESS");
     return true;
 #endif
 }
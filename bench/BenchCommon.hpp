@@ -0,0 +1,138 @@
+#pragma once
+#include "mr/Tokenizer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// ------------------------------------------------------------------
+// Helpers shared by the micro-benchmarks in bench/: a deterministic
+// word corpus with a Zipf-like vocabulary and a best-of-N timer. No
+// external benchmark framework; each bench is a plain executable.
+// ------------------------------------------------------------------
+namespace bench {
+
+// xorshift64*: fast and reproducible across platforms
+class Rng {
+public:
+    explicit Rng(std::uint64_t seed) : s_(seed ? seed : 1) {}
+    std::uint64_t next() {
+        s_ ^= s_ >> 12;
+        s_ ^= s_ << 25;
+        s_ ^= s_ >> 27;
+        return s_ * 0x2545F4914F6CDD1Dull;
+    }
+    std::size_t below(std::size_t n) { return static_cast<std::size_t>(next() % n); }
+
+private:
+    std::uint64_t s_;
+};
+
+// vocab distinct lowercase words of 2-16 letters
+inline std::vector<std::string> makeVocabulary(std::size_t vocab, std::uint64_t seed = 42) {
+    Rng rng(seed);
+    std::unordered_set<std::string> seen;
+    std::vector<std::string> words;
+    words.reserve(vocab);
+    while (words.size() < vocab) {
+        std::string w(2 + rng.below(15), 'a');
+        for (char& c : w) c = static_cast<char>('a' + rng.below(26));
+        if (seen.insert(w).second) words.push_back(std::move(w));
+    }
+    return words;
+}
+
+// Draws word ranks in [0, vocab) with frequency ~ 1/(rank + 1) (Zipf, s = 1)
+class Zipf {
+public:
+    explicit Zipf(std::size_t vocab) : cdf_(vocab ? vocab : 1) {
+        double sum = 0;
+        for (std::size_t r = 0; r < cdf_.size(); ++r) cdf_[r] = (sum += 1.0 / static_cast<double>(r + 1));
+    }
+    std::size_t operator()(Rng& rng) const {
+        const double u = static_cast<double>(rng.next() >> 11) / 9007199254740992.0 * cdf_.back();
+        const std::size_t r = static_cast<std::size_t>(std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin());
+        return std::min(r, cdf_.size() - 1);
+    }
+
+private:
+    std::vector<double> cdf_;
+};
+
+// About `bytes` of text lines: Zipf-drawn words in mixed case, separated
+// by spaces and punctuation, ~80 bytes per line
+inline std::string makeCorpus(std::size_t bytes, std::size_t vocab, std::uint64_t seed = 42) {
+    const std::vector<std::string> words = makeVocabulary(vocab, seed);
+    const Zipf zipf(vocab);
+    static const char* seps[] = { " ", " ", " ", ", ", ". ", "; ", " - ", " 1 " };
+    Rng rng(seed + 1);
+    std::string text;
+    text.reserve(bytes + 128);
+    std::size_t lineStart = 0;
+    while (text.size() < bytes) {
+        std::string w = words[zipf(rng)];
+        if (rng.below(8) == 0) w[0] = static_cast<char>(w[0] - 'a' + 'A');
+        text += w;
+        if (text.size() - lineStart >= 80) {
+            text += '\n';
+            lineStart = text.size();
+        } else {
+            text += seps[rng.below(sizeof(seps) / sizeof(seps[0]))];
+        }
+    }
+    return text;
+}
+
+// The tokens of text as views into one arena, as a mapper sees them
+struct TokenList {
+    std::string                   arena;
+    std::vector<std::string_view> views;
+};
+
+inline TokenList tokenize(const std::string& text) {
+    TokenList out;
+    std::vector<std::size_t> ends;
+    mr::Tokenizer tok;
+    tok.forEachToken(text, [&](std::string_view t) {
+        out.arena.append(t.data(), t.size());
+        ends.push_back(out.arena.size());
+    });
+    out.views.reserve(ends.size());
+    for (std::size_t i = 0, start = 0; i < ends.size(); start = ends[i++])
+        out.views.emplace_back(out.arena.data() + start, ends[i] - start);
+    return out;
+}
+
+// Best wall time of reps calls of fn, in seconds
+template <class Fn>
+double bestSeconds(int reps, Fn&& fn) {
+    double best = 1e30;
+    for (int i = 0; i < reps; ++i) {
+        const auto t0 = std::chrono::steady_clock::now();
+        fn();
+        const std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+        best = std::min(best, dt.count());
+    }
+    return best;
+}
+
+// argv[i] as a size, or fallback
+inline std::size_t argSize(int argc, char** argv, int i, std::size_t fallback) {
+    return argc > i ? static_cast<std::size_t>(std::strtoull(argv[i], nullptr, 10)) : fallback;
+}
+
+// Every bench keeps a result live through this so the timed work is not
+// optimized away
+inline void consume(std::uint64_t v) {
+    static volatile std::uint64_t sink;
+    sink = sink + v;
+}
+
+} // namespace bench
@@ -0,0 +1,123 @@
+// FlatCountTable (Robin Hood, flat arrays) against the structures it
+// replaced, counting the tokens of a generated corpus per word at several
+// vocabulary sizes:
+//   - mr::Grouped (std::map<Word, std::vector<Count>>) filled with one
+//     push_back per token, as Workflow grouped before (the baseline)
+//   - std::unordered_map<std::string, int>, the old in-mapper combiner
+//
+//   count_table_bench [MiB = 32] [reps = 5]
+//
+// Memory is the heap the filled structure holds (requested bytes, without
+// allocator overhead), counted through the global operator new / delete
+// of this executable. All three must agree on every word's count; exits
+// 1 otherwise.
+#include "BenchCommon.hpp"
+#include "mr/FlatCountTable.hpp"
+#include "mr/Types.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// ------------------------- heap accounting -------------------------
+namespace {
+std::atomic<std::size_t> liveBytes{ 0 };
+constexpr std::size_t kHeader = alignof(std::max_align_t); // holds the block size
+}
+
+void* operator new(std::size_t n) {
+    void* p = std::malloc(n + kHeader);
+    if (!p) throw std::bad_alloc();
+    *static_cast<std::size_t*>(p) = n;
+    liveBytes += n;
+    return static_cast<char*>(p) + kHeader;
+}
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    char* base = static_cast<char*>(p) - kHeader;
+    liveBytes -= *reinterpret_cast<std::size_t*>(base);
+    std::free(base);
+}
+void* operator new[](std::size_t n) { return operator new(n); }
+void  operator delete[](void* p) noexcept { operator delete(p); }
+void  operator delete(void* p, std::size_t) noexcept { operator delete(p); }
+void  operator delete[](void* p, std::size_t) noexcept { operator delete(p); }
+
+namespace {
+
+struct Result {
+    double      seconds;
+    std::size_t bytes;   // heap held once filled
+};
+
+// Times fill() (which rebuilds the structure from empty) and measures the
+// heap it holds afterwards; reset() frees it
+template <class Fill, class Reset>
+Result measure(int reps, Fill&& fill, Reset&& reset) {
+    const double sec = bench::bestSeconds(reps, [&] { reset(); fill(); });
+    reset();
+    const std::size_t before = liveBytes;
+    fill();
+    return Result{ sec, liveBytes - before };
+}
+
+void report(const char* name, const Result& r, const Result& base, double mtokens) {
+    std::printf("  %-16s %6.1f M tokens/s  %5.2fx   %8.1f MiB  %5.2fx less\n", name,
+                mtokens / r.seconds, base.seconds / r.seconds,
+                static_cast<double>(r.bytes) / (1 << 20),
+                static_cast<double>(base.bytes) / static_cast<double>(r.bytes ? r.bytes : 1));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t mib  = bench::argSize(argc, argv, 1, 32);
+    const int         reps = static_cast<int>(bench::argSize(argc, argv, 2, 5));
+
+    int status = 0;
+    for (std::size_t vocab : { std::size_t(10000), std::size_t(200000), std::size_t(2000000) }) {
+        const bench::TokenList corpus = bench::tokenize(bench::makeCorpus(mib << 20, vocab));
+        const std::vector<std::string_view>& tokens = corpus.views;
+
+        // Baseline: word -> [1, 1, ...], one push_back per token
+        mr::Grouped grouped;
+        const Result groupedRes = measure(reps, [&] {
+            for (std::string_view t : tokens) grouped[mr::Word(t)].push_back(1);
+        }, [&] { mr::Grouped().swap(grouped); });
+
+        // The pre-FlatCountTable combiner: one reused key string per lookup
+        std::unordered_map<std::string, int> map;
+        const Result mapRes = measure(reps, [&] {
+            std::string key;
+            for (std::string_view t : tokens) {
+                key.assign(t.data(), t.size());
+                ++map[key];
+            }
+        }, [&] { std::unordered_map<std::string, int>().swap(map); });
+
+        mr::FlatCountTable table;
+        const Result flatRes = measure(reps, [&] {
+            for (std::string_view t : tokens) table.add(t, 1);
+        }, [&] { table = mr::FlatCountTable(); });
+
+        bool same = table.size() == grouped.size() && map.size() == grouped.size();
+        for (const auto& kv : grouped) {
+            const int n = static_cast<int>(kv.second.size());
+            same = same && table.find(kv.first) == n && map[kv.first] == n;
+        }
+        if (!same) status = 1;
+
+        const double m = static_cast<double>(tokens.size()) / 1e6;
+        std::printf("vocab %zu (%zu distinct, %.1f M tokens)%s\n", vocab, grouped.size(), m,
+                    same ? "" : "  MISMATCH");
+        report("map<vector>", groupedRes, groupedRes, m);
+        report("unordered_map", mapRes, groupedRes, m);
+        report("FlatCountTable", flatRes, groupedRes, m);
+    }
+    return status;
+}
@@ -0,0 +1,85 @@
+// Shuffle hash (wyhash + multiply-shift, Hash.hpp) against the std::hash
+// modulo partitioning it replaced: hashing throughput over the tokens of
+// a generated corpus, and bucket balance over numReducers.
+//
+//   hash_bench [MiB = 32] [reps = 5]
+//
+// Skew is max bucket / mean bucket (1.00 = perfect), over distinct words
+// (reducer memory) and over tokens (shuffle volume, bounded below by the
+// most frequent words).
+#include "BenchCommon.hpp"
+#include "mr/Hash.hpp"
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct StdHashPartition {
+    const char* name() const { return "std::hash %"; }
+    std::size_t operator()(std::string_view key, std::size_t n) const {
+        return std::hash<std::string_view>{}(key) % n;
+    }
+};
+
+struct ShufflePartition {
+    const char* name() const { return "wyhash"; }
+    std::size_t operator()(std::string_view key, std::size_t n) const {
+        return mr::reduceHash(mr::hashKey(key), n);
+    }
+};
+
+double skew(const std::vector<std::uint64_t>& buckets) {
+    std::uint64_t total = 0, peak = 0;
+    for (std::uint64_t b : buckets) {
+        total += b;
+        peak = std::max(peak, b);
+    }
+    return total ? static_cast<double>(peak) * buckets.size() / static_cast<double>(total) : 0;
+}
+
+template <class Partition>
+void run(const Partition& part, const std::vector<std::string_view>& tokens,
+         const std::unordered_map<std::string_view, std::uint64_t>& freq, int reps) {
+    static const std::size_t kReducers[] = { 4, 16, 64, 256 };
+
+    const double sec = bench::bestSeconds(reps, [&] {
+        std::uint64_t sum = 0;
+        for (std::string_view t : tokens) sum += part(t, 16);
+        bench::consume(sum);
+    });
+    std::printf("%-12s %7.1f M keys/s   skew words/tokens:", part.name(),
+                static_cast<double>(tokens.size()) / sec / 1e6);
+
+    for (std::size_t n : kReducers) {
+        std::vector<std::uint64_t> words(n), load(n);
+        for (const auto& kv : freq) {
+            const std::size_t b = part(kv.first, n);
+            ++words[b];
+            load[b] += kv.second;
+        }
+        std::printf("  r=%zu %.3f/%.3f", n, skew(words), skew(load));
+    }
+    std::printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t mib  = bench::argSize(argc, argv, 1, 32);
+    const int         reps = static_cast<int>(bench::argSize(argc, argv, 2, 5));
+
+    const bench::TokenList corpus = bench::tokenize(bench::makeCorpus(mib << 20, 200000));
+    const std::vector<std::string_view>& tokens = corpus.views;
+    std::unordered_map<std::string_view, std::uint64_t> freq;
+    for (std::string_view t : tokens) ++freq[t];
+    std::printf("corpus: %zu MiB, %zu tokens, %zu distinct words\n", mib, tokens.size(), freq.size());
+
+    run(StdHashPartition(), tokens, freq, reps);
+    run(ShufflePartition(), tokens, freq, reps);
+    return 0;
+}
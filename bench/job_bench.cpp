@@ -0,0 +1,109 @@
+// Word count three ways over the same generated input: the builtin
+// Workflow (Mapper / Reducer objects), Workflow with the Map/Reduce
+// plugins (virtual calls across the library boundary) and the
+// compile-time mr::WordCountJob.
+//
+//   job_bench [MiB = 64] [threads = 1] [reps = 3] [pluginDir = this exe's dir]
+//
+// The three word_counts.txt files must be identical; exits 1 otherwise.
+// A plugin dir without loadable plugins skips that path.
+#include "BenchCommon.hpp"
+#include "mr/FileManager.hpp"
+#include "mr/Job.hpp"
+#include "mr/PluginLoader.hpp"
+#include "mr/Workflow.hpp"
+
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string slurp(const fs::path& p) {
+    std::ifstream in(p, std::ios::binary);
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t mib     = bench::argSize(argc, argv, 1, 64);
+    const unsigned    threads = static_cast<unsigned>(bench::argSize(argc, argv, 2, 1));
+    const int         reps    = static_cast<int>(bench::argSize(argc, argv, 3, 3));
+    const std::string pluginDir =
+        argc > 4 ? argv[4] : fs::absolute(fs::path(argv[0])).parent_path().string();
+
+    const fs::path root = fs::temp_directory_path() /
+                          ("mr_job_bench_" + std::to_string(mr::currentProcessId()));
+    const fs::path input = root / "input";
+    fs::create_directories(input);
+
+    // 8 input files, so the map threads have separate files and chunks
+    const std::string text = bench::makeCorpus(mib << 20, 200000);
+    const std::size_t per = text.size() / 8 + 1;
+    for (std::size_t f = 0, pos = 0; pos < text.size(); ++f) {
+        std::size_t end = std::min(text.size(), pos + per);
+        while (end < text.size() && text[end - 1] != '\n') ++end;
+        std::ofstream(input / ("part" + std::to_string(f) + ".txt"), std::ios::binary)
+            .write(text.data() + pos, static_cast<std::streamsize>(end - pos));
+        pos = end;
+    }
+    std::printf("input: %zu MiB in 8 files, %u thread(s), best of %d\n", mib, threads, reps);
+
+    mr::FileManager fm;
+    auto output = [&](const char* name) { return (root / name).string(); };
+    auto workflow = [&](const char* name) {
+        mr::Workflow wf(fm, input.string(), output("temp"), output(name));
+        wf.setThreads(threads);
+        return wf;
+    };
+
+    struct Path {
+        const char*           name;
+        std::function<void()> run;
+    };
+    const std::vector<Path> paths = {
+        { "workflow", [&] { workflow("out_workflow").run(); } },
+        { "plugins",  [&] { workflow("out_plugins").runWithPlugins(pluginDir); } },
+        { "job",      [&] {
+              mr::WordCountJob job(fm, {}, {});
+              job.setThreads(threads);
+              job.run(input.string(), output("out_job"));
+          } },
+    };
+
+    int status = 0;
+    double baseline = 0;
+    std::string expected;
+    for (const Path& p : paths) {
+        double sec = 0;
+        try {
+            sec = bench::bestSeconds(reps, p.run);
+        } catch (const std::exception& e) {
+            std::printf("%-9s skipped: %s\n", p.name, e.what());
+            continue;
+        }
+        const std::string counts = slurp(root / (std::string("out_") + p.name) / "word_counts.txt");
+        if (expected.empty()) {
+            expected = counts;
+            baseline = sec;
+        }
+        const bool same = counts == expected;
+        if (!same) status = 1;
+        std::printf("%-9s %7.3f s  %6.1f MiB/s  %5.2fx  %s\n", p.name, sec,
+                    static_cast<double>(mib) / sec, baseline / sec, same ? "ok" : "MISMATCH");
+    }
+
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    return status;
+}
@@ -0,0 +1,108 @@
+// Tokenizer kernels (MR_SIMD values) against the byte-at-a-time
+// isalpha/tolower splitter Mapper used before, on a generated corpus.
+//
+//   tokenizer_bench [MiB = 64] [reps = 5]
+//
+// Every kernel's tokens are checked against the scalar kernel's and the
+// reference splitter's; exits 1 on a mismatch.
+#include "BenchCommon.hpp"
+#include "mr/Tokenizer.hpp"
+
+#include <cctype>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+// The pre-SIMD Mapper::map tokenizer ("C" locale)
+template <class Fn>
+void referenceTokens(std::string_view line, std::string& scratch, Fn&& fn) {
+    scratch.assign(line.data(), line.size());
+    for (char& c : scratch) {
+        const unsigned char uc = static_cast<unsigned char>(c);
+        c = std::isalpha(uc) ? static_cast<char>(std::tolower(uc)) : ' ';
+    }
+    const std::size_t n = scratch.size();
+    for (std::size_t i = 0; i < n;) {
+        while (i < n && scratch[i] == ' ') ++i;
+        const std::size_t start = i;
+        while (i < n && scratch[i] != ' ') ++i;
+        if (i > start) fn(std::string_view(scratch.data() + start, i - start));
+    }
+}
+
+// Token stream digest: order- and content-sensitive
+struct Digest {
+    std::uint64_t h = 1469598103934665603ull, tokens = 0;
+    void add(std::string_view t) {
+        for (unsigned char c : t) h = (h ^ c) * 1099511628211ull;
+        h = (h ^ 0xFF) * 1099511628211ull;
+        ++tokens;
+    }
+    bool operator==(const Digest& o) const { return h == o.h && tokens == o.tokens; }
+};
+
+std::vector<std::string_view> splitLines(const std::string& text) {
+    std::vector<std::string_view> lines;
+    for (std::size_t pos = 0; pos < text.size();) {
+        std::size_t nl = text.find('\n', pos);
+        if (nl == std::string::npos) nl = text.size();
+        lines.emplace_back(text.data() + pos, nl - pos);
+        pos = nl + 1;
+    }
+    return lines;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t mib  = bench::argSize(argc, argv, 1, 64);
+    const int         reps = static_cast<int>(bench::argSize(argc, argv, 2, 5));
+
+    const std::string text = bench::makeCorpus(mib << 20, 50000);
+    const std::vector<std::string_view> lines = splitLines(text);
+    std::printf("corpus: %zu MiB, %zu lines; default kernel: %s\n",
+                mib, lines.size(), mr::Tokenizer::kernelName());
+
+    // Timed passes only sum token lengths; digests are taken in a separate
+    // untimed pass so hashing does not mask the tokenizer cost
+    std::string scratch;
+    Digest ref;
+    for (std::string_view line : lines)
+        referenceTokens(line, scratch, [&](std::string_view t) { ref.add(t); });
+    const double refSec = bench::bestSeconds(reps, [&] {
+        std::uint64_t bytes = 0;
+        for (std::string_view line : lines)
+            referenceTokens(line, scratch, [&](std::string_view t) { bytes += t.size(); });
+        bench::consume(bytes);
+    });
+    const double mb = static_cast<double>(text.size()) / (1 << 20);
+    std::printf("%-10s %8.1f MiB/s  %5.2fx  (%llu tokens)\n", "reference", mb / refSec, 1.0,
+                static_cast<unsigned long long>(ref.tokens));
+
+    Digest scalar;
+    mr::Tokenizer scalarTok("scalar");
+    for (std::string_view line : lines)
+        scalarTok.forEachToken(line, [&](std::string_view t) { scalar.add(t); });
+
+    int status = 0;
+    for (const std::string& name : mr::Tokenizer::availableKernels()) {
+        mr::Tokenizer tok(name);
+        Digest d;
+        for (std::string_view line : lines)
+            tok.forEachToken(line, [&](std::string_view t) { d.add(t); });
+        const double sec = bench::bestSeconds(reps, [&] {
+            std::uint64_t bytes = 0;
+            for (std::string_view line : lines)
+                tok.forEachToken(line, [&](std::string_view t) { bytes += t.size(); });
+            bench::consume(bytes);
+        });
+        const bool same = d == ref && d == scalar;
+        std::printf("%-10s %8.1f MiB/s  %5.2fx  %s\n", name.c_str(), mb / sec, refSec / sec,
+                    same ? "ok" : "MISMATCH");
+        if (!same) status = 1;
+    }
+    return status;
+}
@@ -1,23 +1,50 @@
 #include "mr/Interfaces.hpp"
-#include <algorithm>
-#include <cctype>
-#include <sstream>
+#include "mr/Tokenizer.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace {
 struct SimpleMapper : mr::IMapper {
   void map(const std::string&, const std::string& line, mr::IMapContext& ctx) override {
-    std::string cleaned = line;
-    for (char& c : cleaned) {
-      unsigned char uc = static_cast<unsigned char>(c);
-      c = std::isalpha(uc) ? static_cast<char>(std::tolower(uc)) : ' ';
+    tokenizer_.forEachToken(line, [&](std::string_view t) {
+      tok_.assign(t.data(), t.size());
+      ctx.emit(tok_, 1);
+    });
+  }
+  // Tokens may live in the tokenizer's fold buffer, so the batch's tokens
+  // are packed into one arena and handed over in a single emitBatch
+  void mapBatch(const std::string&, const std::string_view* lines, std::size_t count,
+                mr::IMapContext& ctx) override {
+    arena_.clear();
+    ends_.clear();
+    for (std::size_t i = 0; i < count; ++i) {
+      tokenizer_.forEachToken(lines[i], [&](std::string_view t) {
+        arena_.append(t.data(), t.size());
+        ends_.push_back(arena_.size());
+      });
+    }
+    words_.clear();
+    std::size_t begin = 0;
+    for (std::size_t end : ends_) {
+      words_.emplace_back(arena_.data() + begin, end - begin);
+      begin = end;
     }
-    std::istringstream iss(cleaned);
-    std::string tok;
-    while (iss >> tok) ctx.emit(tok, 1);
+    if (ones_.size() < words_.size()) ones_.resize(words_.size(), 1);
+    ctx.emitBatch(words_.data(), ones_.data(), words_.size());
   }
   void flush(mr::IMapContext&) override {}
+
+private:
+  mr::Tokenizer                 tokenizer_;
+  std::string                   tok_;
+  std::string                   arena_;   // mapBatch tokens, back to back
+  std::vector<std::size_t>      ends_;
+  std::vector<std::string_view> words_;
+  std::vector<mr::Count>        ones_;
 };
 }
 
-extern "C" __declspec(dllexport) mr::IMapper*  __stdcall CreateMapper()  { return new SimpleMapper(); }
-extern "C" __declspec(dllexport) void          __stdcall DestroyMapper(mr::IMapper* p) { delete p; }
+MR_PLUGIN_EXPORT mr::IMapper* MR_CALL CreateMapper()  { return new SimpleMapper(); }
+MR_PLUGIN_EXPORT void         MR_CALL DestroyMapper(mr::IMapper* p) { delete p; }
+MR_PLUGIN_EXPORT int          MR_CALL MrPluginAbiVersion() { return mr::kPluginAbiVersion; }
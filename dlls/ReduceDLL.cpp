@@ -1,14 +1,23 @@
 #include "mr/Interfaces.hpp"
-#include <numeric>
 
 namespace {
+// Sums values as they stream in; reduce(vector) comes from the IReducer shim
 struct SimpleReducer : mr::IReducer {
-  void reduce(const mr::Word& w, const std::vector<mr::Count>& counts, mr::IReduceContext& ctx) override {
-    int total = std::accumulate(counts.begin(), counts.end(), 0);
+  void reduceStream(const mr::Word& w, mr::IValueStream& values, mr::IReduceContext& ctx) override {
+    int total = 0;
+    for (int v = 0; values.next(v); ) total += v;
     ctx.emit(w, total);
   }
 };
+
+// Partial sums are still sums, so the host may pre-aggregate with this
+struct SumCombiner : mr::ICombiner {
+  mr::Count combine(std::string_view, mr::Count a, mr::Count b) override { return a + b; }
+};
 }
 
-extern "C" __declspec(dllexport) mr::IReducer* __stdcall CreateReducer()  { return new SimpleReducer(); }
-extern "C" __declspec(dllexport) void         __stdcall DestroyReducer(mr::IReducer* p) { delete p; }
+MR_PLUGIN_EXPORT mr::IReducer*  MR_CALL CreateReducer()  { return new SimpleReducer(); }
+MR_PLUGIN_EXPORT void           MR_CALL DestroyReducer(mr::IReducer* p) { delete p; }
+MR_PLUGIN_EXPORT mr::ICombiner* MR_CALL CreateCombiner() { return new SumCombiner(); }
+MR_PLUGIN_EXPORT void           MR_CALL DestroyCombiner(mr::ICombiner* p) { delete p; }
+MR_PLUGIN_EXPORT int            MR_CALL MrPluginAbiVersion() { return mr::kPluginAbiVersion; }
@@ -0,0 +1,111 @@
+#pragma once
+#include "FileManager.hpp"
+#include "FlatCountTable.hpp"
+#include "InputSplit.hpp"
+#include "KVBuffer.hpp"
+#include "ValueStream.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace mr {
+
+// ------------------------------------------------------------------
+// ExternalSorter: sort-and-group of (word, count) pairs in bounded memory.
+// Pairs collect in a KVBuffer; whenever its footprint reaches the memory
+// cap the buffer is sorted and written to the temp dir as a run file
+// (key order, intermediate format of RecordFormat.hpp). forEachGroup()
+// then k-way merges the runs through a loser tree and hands every
+// distinct word, in key order, to the callback together with all of its
+// counts. forEachGroupStream() instead exposes each word's counts as an
+// IValueStream read straight off the merge, so no value list is built. If nothing was spilled the
+// groups come straight from the in-memory buffer.
+//
+// With combineBySum() pairs are summed per word in a FlatCountTable
+// instead, so memory follows the vocabulary rather than the token count;
+// merge passes sum equal words again, and each group holds the single
+// total. Only valid when the reduce step is a sum. combineWith() does the
+// same with a caller's combine function (e.g. a plugin ICombiner).
+//
+// Record ranges that are already key-sorted (addSortedRun) join the
+// merge as they are, next to the spilled runs, without being re-read
+// into memory.
+// ------------------------------------------------------------------
+class ExternalSorter {
+public:
+    static constexpr std::size_t kDefaultMemoryBytes = 256u << 20; // 256 MiB
+
+    using GroupFn = std::function<void(const std::string& word,
+                                       const std::vector<int>& counts)>;
+    using GroupStreamFn = std::function<void(const std::string& word,
+                                             IValueStream& counts)>;
+
+    // Run files are named <runPrefix><n>.txt
+    ExternalSorter(FileManager& fm, std::string runPrefix,
+                   std::size_t memoryBytes = kDefaultMemoryBytes);
+    ~ExternalSorter();   // removes the run files
+
+    ExternalSorter(const ExternalSorter&) = delete;
+    ExternalSorter& operator=(const ExternalSorter&) = delete;
+
+    // combine(word, a, b) folds two values of word into one; it must be
+    // associative and commutative
+    using CombineFn = std::function<int(std::string_view word, int a, int b)>;
+
+    // Must be called before the first add()
+    void combineBySum() { combine_ = true; }
+    void combineWith(CombineFn combine) {
+        combine_   = true;
+        combineFn_ = std::move(combine);
+    }
+
+    void add(std::string_view word, int count);
+
+    // Reads an intermediate file (either RecordFormat)
+    void addFile(const std::string& path);
+
+    // Merges a key-sorted range of an intermediate file as one run; the
+    // file stays owned by the caller (it is not deleted)
+    void addSortedRun(InputSplit run);
+
+    // Streams the sorted groups; the sorter is empty afterwards
+    void forEachGroup(const GroupFn& fn);
+    void forEachGroupStream(const GroupStreamFn& fn);
+
+    std::size_t runCount() const { return runs_.size(); }
+
+private:
+    void spill();
+    void compactRuns();   // merge passes until one merge takes every run
+    std::size_t mergeWindowBytes(std::size_t fanIn) const;
+    void removeRuns();
+    std::string nextRunPath();
+    std::vector<InputSplit> runRanges(std::size_t begin, std::size_t end) const;
+    std::size_t pendingBytes() const;
+    const KVBuffer& pending() const { return combine_ ? table_.entries() : buffer_; }
+    int combine(std::string_view word, int a, int b) const {
+        return combineFn_ ? combineFn_(word, a, b) : a + b;
+    }
+
+    FileManager&               fm_;
+    std::string                runPrefix_;
+    std::size_t                memoryBytes_;
+    bool                       combine_ = false;
+    CombineFn                  combineFn_; // empty: sum
+    KVBuffer                   buffer_;  // raw pairs
+    FlatCountTable             table_;   // summed pairs (combine_)
+    std::vector<std::uint32_t> order_;   // reused sort permutation
+
+    struct Run {
+        InputSplit range;
+        bool       owned;   // spilled here, removed once merged
+    };
+    std::vector<Run>           runs_;
+    std::size_t                runSeq_ = 0;
+};
+
+} // namespace mr
@@ -1,15 +1,70 @@
 #pragma once
+#include <cstddef>
+#include <fstream>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <unordered_set>
 #include <vector>
 
 namespace mr {
 
+// Appends one intermediate record, "key\tcount\n", to out
+void appendRecord(std::string& out, std::string_view key, long long count);
+
+// ------------------------------------------------------------------
+// AppendSink: long-lived buffered writer bound to a single file.
+// Records collect in a user-space buffer and reach the OS as large
+// sequential writes; the file stays open until close() or destruction.
+// ------------------------------------------------------------------
+class AppendSink {
+public:
+    static constexpr std::size_t kDefaultBufferBytes = 1u << 20; // 1 MiB
+
+    AppendSink() = default;
+    AppendSink(const std::string& path, bool truncate,
+               std::size_t bufferBytes = kDefaultBufferBytes);
+    ~AppendSink();
+
+    AppendSink(AppendSink&& other) noexcept;
+    AppendSink& operator=(AppendSink&& other) noexcept;
+    AppendSink(const AppendSink&) = delete;
+    AppendSink& operator=(const AppendSink&) = delete;
+
+    bool isOpen() const { return out_.is_open(); }
+    const std::string& path() const { return path_; }
+
+    // Raw bytes / single char, no terminator added.
+    void write(std::string_view bytes);
+    void put(char c);
+
+    // "line\n"
+    void writeLine(std::string_view line);
+
+    // "key\tcount\n" without building a temporary string
+    void writeRecord(std::string_view key, long long count);
+
+    // Push the user-space buffer to the OS; close() also releases the file.
+    void flush();
+    void close();
+
+private:
+    void reserveFor(std::size_t n);
+
+    std::ofstream out_;
+    std::string   path_;
+    std::string   buf_;
+    std::size_t   capacity_ = kDefaultBufferBytes;
+};
+
 // ------------------------------------------------------------------
 // FileManager: encapsulates all file and directory operations.
 // ------------------------------------------------------------------
 class FileManager {
 public:
     // Ensuring that the directory exists; create it in case it's missing.
+    // Directories already created through this FileManager are remembered,
+    // so repeated calls for the same directory skip the filesystem.
     void ensureDir(const std::string& dir);
 
     // Checking for the existence of a file or directory
@@ -18,20 +73,34 @@ public:
     // entire string to a file (truncates existing contents).
     void writeAll(const std::string& path, const std::string& data);
 
-    // Appending a single line to a file and create directories if needed
+    // Appending a single line to a file and create directories if needed.
+    // Opens and closes the file on every call: use openAppend() on hot paths.
     void appendLine(const std::string& path, const std::string& line);
 
+    // Opening a long-lived buffered writer (parent directories created once).
+    AppendSink openAppend(const std::string& path, bool truncate = false,
+                          std::size_t bufferBytes = AppendSink::kDefaultBufferBytes);
+
     // Reading all lines from text file into a vector
     std::vector<std::string> readAllLines(const std::string& path);
 
     // Listings all the files in a given or determined directory
     std::vector<std::string> listFiles(const std::string& dir);
 
+    // Deleting a file; a missing file is not an error
+    bool removeFile(const std::string& path);
+
     // Creating an empty file to be used for the SUCCESS MARKER
     bool writeEmptyFile(const std::string& path);
 
     // Listing only text files (*.txt or no extension) in a directory.
     std::vector<std::string> listTextFiles(const std::string& dir);
+
+private:
+    void ensureParentDir(const std::string& path);
+
+    std::mutex                      dirMu_;
+    std::unordered_set<std::string> knownDirs_;
 };
 
 } // namespace mr
@@ -0,0 +1,158 @@
+#pragma once
+#include "Hash.hpp"
+#include "KVBuffer.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace mr {
+
+// ------------------------------------------------------------------
+// FlatCountTable: word -> summed count, open addressing with Robin Hood
+// probing. Distinct words are stored once in a KVBuffer (key arena +
+// count/hash columns, insertion order); the probe index is a flat array
+// of 8-byte slots holding an entry number, a 16-bit hash tag and the
+// probe distance, so a lookup touches one cache line of index and only
+// compares key bytes on a tag match. No per-word node, string or vector
+// allocation. clear() keeps both arrays' capacity. Holds at most
+// KVBuffer::kMaxKeyBytes of distinct key bytes; adding a new key past
+// that throws std::length_error (callers spill before, see fits()).
+// ------------------------------------------------------------------
+class FlatCountTable {
+public:
+    using Count = KVBuffer::Count;
+
+    explicit FlatCountTable(std::size_t expectedKeys = 0) {
+        std::size_t cap = kMinSlots;
+        while (cap * kMaxLoadNum < expectedKeys * kMaxLoadDen) cap <<= 1;
+        rehash(cap);
+    }
+
+    std::size_t size() const  { return entries_.size(); }
+    bool        empty() const { return entries_.empty(); }
+
+    // Heap footprint: key arena, entry columns and probe index
+    std::size_t memoryBytes() const {
+        return entries_.memoryBytes() + slots_.size() * sizeof(Slot);
+    }
+
+    void add(std::string_view key, Count count) { add(key, hashKey(key), count); }
+
+    // hash must be hashKey(key)
+    void add(std::string_view key, std::uint64_t hash, Count count) {
+        merge(key, hash, count, [](Count a, Count b) { return a + b; });
+    }
+
+    // Like add(), with combine(old, count) instead of a sum for a key
+    // already present (the first count of a key is stored as is)
+    template <class Combine>
+    void merge(std::string_view key, std::uint64_t hash, Count count, Combine&& combine) {
+        const std::uint16_t tag = tagOf(hash);
+        std::size_t i = home(hash);
+        for (std::uint32_t dist = 0;; ++dist, i = (i + 1) & mask_) {
+            const Slot& s = slots_[i];
+            if (s.entry == kEmpty || s.dist < dist) break;   // Robin Hood: key absent
+            if (s.tag == tag && entries_.key(s.entry) == key) {
+                Count& c = entries_.count(s.entry);
+                c = combine(c, count);
+                return;
+            }
+        }
+        if ((entries_.size() + 1) * kMaxLoadDen > slots_.size() * kMaxLoadNum) {
+            rehash(slots_.size() * 2);
+        }
+        place(static_cast<std::uint32_t>(entries_.push(key, count, hash)), hash);
+    }
+
+    // Summed (combined) count of key, or 0 when absent
+    Count find(std::string_view key) const {
+        const std::uint64_t hash = hashKey(key);
+        const std::uint16_t tag = tagOf(hash);
+        std::size_t i = home(hash);
+        for (std::uint32_t dist = 0;; ++dist, i = (i + 1) & mask_) {
+            const Slot& s = slots_[i];
+            if (s.entry == kEmpty || s.dist < dist) return 0;
+            if (s.tag == tag && entries_.key(s.entry) == key) return entries_.count(s.entry);
+        }
+    }
+
+    // Whether a new key of keySize bytes can still be added
+    bool fits(std::size_t keySize) const { return entries_.fits(keySize); }
+
+    // Distinct words in insertion order (key(i), count(i), hash(i))
+    const KVBuffer& entries() const { return entries_; }
+
+    // fn(key, count) for every word, unordered (insertion order)
+    template <class Fn>
+    void forEach(Fn&& fn) const {
+        for (std::size_t i = 0; i < entries_.size(); ++i) fn(entries_.key(i), entries_.count(i));
+    }
+
+    // fn(key, count) for every word in key order; order is a reusable scratch
+    template <class Fn>
+    void forEachSorted(Fn&& fn, std::vector<std::uint32_t>& order) const {
+        entries_.sortedOrder(order);
+        for (std::uint32_t i : order) fn(entries_.key(i), entries_.count(i));
+    }
+
+    template <class Fn>
+    void forEachSorted(Fn&& fn) const {
+        std::vector<std::uint32_t> order;
+        forEachSorted(std::forward<Fn>(fn), order);
+    }
+
+    void clear() {
+        entries_.clear();
+        std::fill(slots_.begin(), slots_.end(), Slot{});
+    }
+
+private:
+    struct Slot {
+        std::uint32_t entry = kEmpty;
+        std::uint16_t tag   = 0;
+        std::uint16_t dist  = 0;   // distance from the home slot
+    };
+    static constexpr std::uint32_t kEmpty    = ~std::uint32_t(0);
+    static constexpr std::size_t   kMinSlots = 1024;
+    static constexpr std::size_t   kMaxLoadNum = 4, kMaxLoadDen = 5;   // 80 %
+
+    // Home slot from bits 16 and up, tag from the low 16. Not the top bits:
+    // reduceHash() partitions on those, so within one shard they are
+    // nearly constant and would crowd every key into a fraction of the table.
+    std::size_t home(std::uint64_t hash) const {
+        return static_cast<std::size_t>(hash >> 16) & mask_;
+    }
+    static std::uint16_t tagOf(std::uint64_t hash) {
+        return static_cast<std::uint16_t>(hash);
+    }
+
+    // Insert a new (known absent) entry, displacing richer slots
+    void place(std::uint32_t entry, std::uint64_t hash) {
+        Slot ins{ entry, tagOf(hash), 0 };
+        for (std::size_t i = home(hash);; i = (i + 1) & mask_, ++ins.dist) {
+            Slot& s = slots_[i];
+            if (s.entry == kEmpty) {
+                s = ins;
+                return;
+            }
+            if (s.dist < ins.dist) std::swap(s, ins);
+        }
+    }
+
+    void rehash(std::size_t slots) {
+        slots_.assign(slots, Slot{});
+        mask_ = slots - 1;
+        for (std::size_t e = 0; e < entries_.size(); ++e) {
+            place(static_cast<std::uint32_t>(e), entries_.hash(e));
+        }
+    }
+
+    KVBuffer          entries_;
+    std::vector<Slot> slots_;
+    std::size_t       mask_ = 0;
+};
+
+} // namespace mr
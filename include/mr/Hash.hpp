@@ -0,0 +1,128 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+  #include <intrin.h>   // _umul128
+#endif
+
+namespace mr {
+
+// ------------------------------------------------------------------
+// Shuffle hash: wyhash (final4 layout) over the key bytes.
+// Unlike std::hash the result is fixed by this code alone: loads are
+// assembled little-endian byte by byte and the 64x64->128 multiply is
+// exact on every path, so MSVC, libstdc++ and libc++ builds -- on any
+// CPU -- route a word to the same reducer. Do not change the constants
+// or seed without changing every worker at once.
+// ------------------------------------------------------------------
+namespace hash_detail {
+
+inline void mum(std::uint64_t& a, std::uint64_t& b) {
+#if defined(__SIZEOF_INT128__)
+    const unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+    a = static_cast<std::uint64_t>(r);
+    b = static_cast<std::uint64_t>(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    std::uint64_t hi = 0;
+    a = _umul128(a, b, &hi);
+    b = hi;
+#else
+    // portable 64x64 -> 128 from 32-bit halves
+    const std::uint64_t ha = a >> 32, la = a & 0xFFFFFFFFu;
+    const std::uint64_t hb = b >> 32, lb = b & 0xFFFFFFFFu;
+    const std::uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    const std::uint64_t t  = rl + (rm0 << 32);
+    std::uint64_t carry    = t < rl;
+    const std::uint64_t lo = t + (rm1 << 32);
+    carry += lo < t;
+    a = lo;
+    b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+#endif
+}
+
+inline std::uint64_t mix(std::uint64_t a, std::uint64_t b) {
+    mum(a, b);
+    return a ^ b;
+}
+
+inline std::uint64_t r8(const unsigned char* p) {
+    return  std::uint64_t(p[0])        | (std::uint64_t(p[1]) << 8)  |
+           (std::uint64_t(p[2]) << 16) | (std::uint64_t(p[3]) << 24) |
+           (std::uint64_t(p[4]) << 32) | (std::uint64_t(p[5]) << 40) |
+           (std::uint64_t(p[6]) << 48) | (std::uint64_t(p[7]) << 56);
+}
+
+inline std::uint64_t r4(const unsigned char* p) {
+    return  std::uint64_t(p[0])        | (std::uint64_t(p[1]) << 8) |
+           (std::uint64_t(p[2]) << 16) | (std::uint64_t(p[3]) << 24);
+}
+
+inline std::uint64_t r3(const unsigned char* p, std::size_t k) {
+    return (std::uint64_t(p[0]) << 16) | (std::uint64_t(p[k >> 1]) << 8) | p[k - 1];
+}
+
+static constexpr std::uint64_t kSecret[4] = {
+    0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+    0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull
+};
+
+} // namespace hash_detail
+
+static constexpr std::uint64_t kShuffleHashSeed = 0x6d725f73687566ull; // "mr_shuf"
+
+inline std::uint64_t hashBytes(const void* data, std::size_t len,
+                               std::uint64_t seed = kShuffleHashSeed) {
+    using namespace hash_detail;
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    seed ^= mix(seed ^ kSecret[0], kSecret[1]);
+
+    std::uint64_t a = 0, b = 0;
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (r4(p) << 32) | r4(p + ((len >> 3) << 2));
+            b = (r4(p + len - 4) << 32) | r4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = r3(p, len);
+        }
+    } else {
+        std::size_t i = len;
+        if (i > 48) {
+            std::uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = mix(r8(p)      ^ kSecret[1], r8(p + 8)  ^ seed);
+                see1 = mix(r8(p + 16) ^ kSecret[2], r8(p + 24) ^ see1);
+                see2 = mix(r8(p + 32) ^ kSecret[3], r8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = mix(r8(p) ^ kSecret[1], r8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = r8(p + i - 16);
+        b = r8(p + i - 8);
+    }
+    a ^= kSecret[1];
+    b ^= seed;
+    mum(a, b);
+    return mix(a ^ kSecret[0] ^ len, b ^ kSecret[1]);
+}
+
+inline std::uint64_t hashKey(std::string_view key, std::uint64_t seed = kShuffleHashSeed) {
+    return hashBytes(key.data(), key.size(), seed);
+}
+
+// Map a 64-bit hash onto [0, n) with a multiply instead of a modulo
+// (uses the high bits, which wyhash mixes best).
+inline std::size_t reduceHash(std::uint64_t h, std::size_t n) {
+    std::uint64_t lo = h, hi = static_cast<std::uint64_t>(n);
+    hash_detail::mum(lo, hi);
+    return static_cast<std::size_t>(hi);
+}
+
+} // namespace mr
@@ -0,0 +1,130 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <charconv>
+#include <filesystem>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+namespace mr {
+
+// ------------------------------------------------------------------
+// InputSplit: a byte range of one input file handed to a mapper.
+// Manifest lines are either a bare path (whole file, the original
+// format) or "path<TAB>offset<TAB>length". Readers align the range to
+// line boundaries (see LineReader), so splits can be cut anywhere.
+// ------------------------------------------------------------------
+struct InputSplit {
+    static constexpr std::uint64_t kWholeFile = ~std::uint64_t(0);
+
+    std::string   path;
+    std::uint64_t offset = 0;
+    std::uint64_t length = kWholeFile;
+
+    bool isWholeFile() const { return offset == 0 && length == kWholeFile; }
+};
+
+// Manifest directive naming the range-partitioner bounds file:
+//   "#range-bounds<TAB><path>"  (absent => hash partitioning)
+static constexpr const char* kRangeBoundsDirective = "#range-bounds";
+
+inline std::string formatSplit(const InputSplit& s) {
+    if (s.isWholeFile()) return s.path;
+    return s.path + "\t" + std::to_string(s.offset) + "\t" + std::to_string(s.length);
+}
+
+inline bool parseSplit(const std::string& line, InputSplit& out) {
+    if (line.empty()) return false;
+    const std::size_t t2 = line.rfind('\t');
+    const std::size_t t1 = (t2 == std::string::npos || t2 == 0)
+                               ? std::string::npos
+                               : line.rfind('\t', t2 - 1);
+    if (t1 == std::string::npos) {
+        out = InputSplit{ line };
+        return true;
+    }
+    InputSplit s;
+    s.path = line.substr(0, t1);
+    const char* end = line.data() + line.size();
+    if (std::from_chars(line.data() + t1 + 1, line.data() + t2, s.offset).ec != std::errc() ||
+        std::from_chars(line.data() + t2 + 1, end, s.length).ec != std::errc())
+        return false;
+    out = std::move(s);
+    return true;
+}
+
+// Cut one file into ~splitBytes pieces (a single whole-file split when it fits)
+inline std::vector<InputSplit> makeSplits(const std::string& path,
+                                          std::uint64_t fileSize,
+                                          std::uint64_t splitBytes) {
+    std::vector<InputSplit> out;
+    if (splitBytes == 0 || fileSize <= splitBytes) {
+        out.push_back(InputSplit{ path });
+        return out;
+    }
+    for (std::uint64_t off = 0; off < fileSize; off += splitBytes) {
+        const std::uint64_t len = (fileSize - off < splitBytes) ? fileSize - off : splitBytes;
+        out.push_back(InputSplit{ path, off, len });
+    }
+    return out;
+}
+
+// Cut one split into ~chunkBytes sub-ranges (for threads inside a worker).
+// Line ownership composes: every line still lands in exactly one piece.
+inline std::vector<InputSplit> subdivideSplit(const InputSplit& split,
+                                              std::uint64_t fileSize,
+                                              std::uint64_t chunkBytes) {
+    const std::uint64_t begin = split.offset;
+    const std::uint64_t end   = (split.length < fileSize - begin) ? begin + split.length : fileSize;
+
+    std::vector<InputSplit> out;
+    if (chunkBytes == 0 || begin >= fileSize || end - begin <= chunkBytes) {
+        out.push_back(split);
+        return out;
+    }
+    for (std::uint64_t off = begin; off < end; off += chunkBytes) {
+        const std::uint64_t len = (end - off < chunkBytes) ? end - off : chunkBytes;
+        out.push_back(InputSplit{ split.path, off, len });
+    }
+    return out;
+}
+
+// Chunk size for the map threads of one process (Workflow, mr::Job,
+// mapper_worker)
+static constexpr std::uint64_t kThreadChunkBytes = 16ull << 20; // 16 MiB
+
+// Every split cut into ~chunkBytes pieces, so each thread has work even
+// when there is a single large file. Splits of a file whose size cannot
+// be read stay whole.
+inline std::vector<InputSplit> chunkSplits(const std::vector<InputSplit>& splits,
+                                           std::uint64_t chunkBytes = kThreadChunkBytes) {
+    std::vector<InputSplit> work;
+    for (const auto& split : splits) {
+        std::error_code ec;
+        const std::uint64_t size = std::filesystem::file_size(split.path, ec);
+        if (ec) { work.push_back(split); continue; }
+        for (auto& piece : subdivideSplit(split, size, chunkBytes)) work.push_back(std::move(piece));
+    }
+    return work;
+}
+
+// Same for whole files
+inline std::vector<InputSplit> chunkFiles(const std::vector<std::string>& paths,
+                                          std::uint64_t chunkBytes = kThreadChunkBytes) {
+    std::vector<InputSplit> files;
+    files.reserve(paths.size());
+    for (const auto& path : paths) files.push_back(InputSplit{ path });
+    return chunkSplits(files, chunkBytes);
+}
+
+// Map threads per process: MR_MAP_THREADS, else every hardware thread
+inline unsigned mapThreadsFromEnv() {
+    unsigned n = std::thread::hardware_concurrency();
+    if (const char* v = std::getenv("MR_MAP_THREADS")) n = static_cast<unsigned>(std::strtoul(v, nullptr, 10));
+    return n ? n : 1;
+}
+
+} // namespace mr
@@ -1,8 +1,21 @@
 #pragma once
+#include <cstddef>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <utility>
 #include <cstdint>
+#include "ValueStream.hpp"
+
+// Calling convention and export decoration of the plugin factories
+// (__stdcall DLL exports on Windows, default-visibility symbols elsewhere)
+#ifdef _WIN32
+  #define MR_CALL __stdcall
+  #define MR_PLUGIN_EXPORT extern "C" __declspec(dllexport)
+#else
+  #define MR_CALL
+  #define MR_PLUGIN_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
 
 namespace mr {
 
@@ -10,42 +23,107 @@ using Word  = std::string;
 using Count = int;
 
 // Context lets DLLs emit output without touching raw filesystem:
+// emitBatch hands over n pairs in one call, without building a Word per
+// pair (the views are copied before it returns). Implemented by the host
+// since plugin ABI 4; appended last so older vtables stay valid.
 struct IMapContext {
     virtual ~IMapContext() = default;
     // write ("word", 1) to intermediate store
     virtual void emit(const Word& w, Count c) = 0;
+    virtual void emitBatch(const std::string_view* words, const Count* counts, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) emit(Word(words[i]), counts[i]);
+    }
 };
 
 struct IReduceContext {
     virtual ~IReduceContext() = default;
     // write final ("word", total) to output store
     virtual void emit(const Word& w, Count total) = 0;
+    virtual void emitBatch(const std::string_view* words, const Count* totals, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) emit(Word(words[i]), totals[i]);
+    }
 };
 
-// Mapper / Reducer interfaces (polymorphism)
+// Mapper / Reducer interfaces (polymorphism). A long-lived host keeps
+// instances for later jobs: a mapper is reused after flush(), a reducer
+// after its last reduce call.
 struct IMapper {
     virtual ~IMapper() = default;
     // fileName provided for parity; DLL may ignore it
     virtual void map(const std::string& fileName, const std::string& line, IMapContext& ctx) = 0;
     virtual void flush(IMapContext& ctx) = 0; // finalize buffered output
+    // A batch of consecutive lines of fileName (views valid for the call
+    // only), so the host pays one virtual call per batch instead of per
+    // line. Only called for plugins whose Map.dll exports
+    // MrPluginAbiVersion() >= 3; appended last so older vtables stay valid.
+    virtual void mapBatch(const std::string& fileName, const std::string_view* lines,
+                          std::size_t count, IMapContext& ctx) {
+        std::string line;
+        for (std::size_t i = 0; i < count; ++i) {
+            line.assign(lines[i].data(), lines[i].size());
+            map(fileName, line, ctx);
+        }
+    }
 };
 
+// Implement reduceStream; reduce(vector) forwards to it. Plugins built
+// against ABI 1 only override reduce, and the host calls nothing else on
+// them (see Workflow::runWithPlugins).
+// The host may create several reducers and run them on different threads
+// at once (one thread per instance, each on its own share of the keys).
+// Words arrive in key order. A reducer may emit any keys (not only the
+// word it was given, and any number of records); the host sorts the final
+// output by key. Output that stays in key order, e.g. one record per
+// word under that word, is merged without being re-sorted.
 struct IReducer {
     virtual ~IReducer() = default;
     // counts is the grouped list e.g. [1,1,1,...]
-    virtual void reduce(const Word& word, const std::vector<Count>& counts, IReduceContext& ctx) = 0;
+    virtual void reduce(const Word& word, const std::vector<Count>& counts, IReduceContext& ctx) {
+        VectorValueStream values(counts);
+        reduceStream(word, values, ctx);
+    }
+    // Values pulled one at a time from the merge (see IValueStream). Only
+    // called for plugins that export MrPluginAbiVersion() >= 2; appended
+    // last so older plugins' vtables stay valid.
+    virtual void reduceStream(const Word& word, IValueStream& values, IReduceContext& ctx) = 0;
+};
+
+// Optional pre-aggregation, exported by Reduce.dll next to its reducer
+// (plugin ABI 5). combine() folds two partial values of one word into
+// one; the host applies it to buffered map output before spilling and to
+// the values it merges ahead of reduce, any number of times and in any
+// grouping. So it must be associative and commutative, and its result
+// must be a value reduce() accepts (e.g. a partial sum for a summing
+// reducer). An instance is used by one thread at a time.
+struct ICombiner {
+    virtual ~ICombiner() = default;
+    virtual Count combine(std::string_view word, Count a, Count b) = 0;
 };
 
 // --------- C factories expected from DLLs ---------
-// extern "C" to avoid C++ name mangling.
-using CreateMapperFn = IMapper*  (__stdcall*)();
-using DestroyMapperFn= void      (__stdcall*)(IMapper*);
-using CreateReducerFn= IReducer* (__stdcall*)();
-using DestroyReducerFn=void      (__stdcall*)(IReducer*);
+// extern "C" to avoid C++ name mangling. Plugins declare them as
+//   MR_PLUGIN_EXPORT mr::IMapper* MR_CALL CreateMapper() { ... }
+using CreateMapperFn = IMapper*  (MR_CALL*)();
+using DestroyMapperFn= void      (MR_CALL*)(IMapper*);
+using CreateReducerFn= IReducer* (MR_CALL*)();
+using DestroyReducerFn=void      (MR_CALL*)(IReducer*);
+using CreateCombinerFn = ICombiner* (MR_CALL*)();     // optional export (Reduce.dll)
+using DestroyCombinerFn= void       (MR_CALL*)(ICombiner*);
+using PluginAbiVersionFn=int      (MR_CALL*)();   // optional export
 
 static constexpr const char* kCreateMapperSym  = "CreateMapper";
 static constexpr const char* kDestroyMapperSym = "DestroyMapper";
 static constexpr const char* kCreateReducerSym = "CreateReducer";
 static constexpr const char* kDestroyReducerSym= "DestroyReducer";
+static constexpr const char* kCreateCombinerSym = "CreateCombiner";
+static constexpr const char* kDestroyCombinerSym= "DestroyCombiner";
+static constexpr const char* kPluginAbiVersionSym = "MrPluginAbiVersion";
+
+// Plugin ABI: 1 = original interfaces (no version export),
+//             2 = IReducer::reduceStream
+//             3 = IMapper::mapBatch
+//             4 = IMapContext / IReduceContext::emitBatch (host side)
+//             5 = ICombiner (CreateCombiner / DestroyCombiner)
+static constexpr int kPluginAbiVersion = 5;
 
 } // namespace mr
@@ -0,0 +1,172 @@
+#pragma once
+#include "FileManager.hpp"
+#include "FlatCountTable.hpp"
+#include "Hash.hpp"
+#include "InputSplit.hpp"
+#include "LineReader.hpp"
+#include "LoserTree.hpp"
+#include "Tokenizer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mr {
+
+// ------------------------------------------------------------------
+// Job<MapFn, ReduceFn, CombineFn>: a MapReduce job whose functions are
+// compile-time parameters, so tokenizing, combining and partitioning
+// inline into one read loop instead of going through Mapper / Reducer
+// objects or plugin virtual calls.
+//
+//   map(line, emit)        calls emit(key, value) for every pair of a line
+//                          (copied per thread, so it may keep scratch state)
+//   combine(a, b) -> value merges two partial values of one key; must be
+//                          associative and commutative
+//   reduce(key, v) -> value final value of a key from its combined value
+//
+// Values are combined as they are emitted, in per-thread hash tables
+// split into hash shards; the shards are then merged and sorted in
+// parallel and written in key order ("key\tvalue", like Workflow). The
+// distinct keys must fit in memory, at most 4 GiB of key bytes per shard
+// (KVBuffer::kMaxKeyBytes; past it run() throws std::length_error): jobs
+// that need every value of a key, or spilling, go through Workflow.
+// ------------------------------------------------------------------
+template <class MapFn, class ReduceFn, class CombineFn = std::plus<int>>
+class Job {
+public:
+    using Count = FlatCountTable::Count;
+
+    Job(FileManager& fm, MapFn map, ReduceFn reduce, CombineFn combine = CombineFn())
+        : fm_(fm), map_(std::move(map)), reduce_(std::move(reduce)), combine_(std::move(combine)),
+          numThreads_(mapThreadsFromEnv()) {}
+
+    // Defaults to MR_MAP_THREADS or every hardware thread, like Workflow
+    void setThreads(unsigned threads) { numThreads_ = threads ? threads : 1; }
+
+    // Every file of inputDir -> outputDir/word_counts.txt and SUCCESS
+    void run(const std::string& inputDir, const std::string& outputDir) {
+        fm_.ensureDir(outputDir);
+        const std::vector<InputSplit> work = chunkFiles(fm_.listFiles(inputDir));
+        const unsigned numShards = numThreads_;
+        const unsigned numMappers = static_cast<unsigned>(
+            std::max<std::size_t>(1, std::min<std::size_t>(numThreads_, work.size())));
+
+        // ----- map + combine: tables[mapper][shard] -----
+        std::vector<std::vector<FlatCountTable>> tables(numMappers);
+        std::atomic<unsigned> nextMapper{ 0 };
+        std::atomic<std::size_t> nextChunk{ 0 };
+        runOnThreads(numMappers, [&] {
+            std::vector<FlatCountTable>& mine = tables[nextMapper++];
+            mine.resize(numShards);
+            MapFn map = map_;
+            auto emit = [&](std::string_view key, Count value) {
+                const std::uint64_t h = hashKey(key);
+                mine[reduceHash(h, numShards)].merge(key, h, value, combine_);
+            };
+            for (std::size_t i; (i = nextChunk++) < work.size();) {
+                const InputSplit& split = work[i];
+                LineReader reader(split.path, split.offset, split.length);
+                std::string_view line;
+                while (reader.next(line)) map(line, emit);
+            }
+        });
+
+        // ----- merge every shard into mapper 0's table and sort it -----
+        std::vector<std::vector<std::uint32_t>> orders(numShards);
+        std::atomic<unsigned> nextShard{ 0 };
+        runOnThreads(std::min(numThreads_, numShards), [&] {
+            for (unsigned s; (s = nextShard++) < numShards;) {
+                FlatCountTable& dst = tables[0][s];
+                for (unsigned m = 1; m < numMappers; ++m) {
+                    const KVBuffer& src = tables[m][s].entries();
+                    for (std::size_t i = 0; i < src.size(); ++i)
+                        dst.merge(src.key(i), src.hash(i), src.count(i), combine_);
+                    tables[m][s] = FlatCountTable();
+                }
+                dst.entries().sortedOrder(orders[s]);
+            }
+        });
+
+        // ----- reduce, k-way merging the sorted shards -----
+        write(outputDir + "/word_counts.txt", tables[0], orders);
+        fm_.writeEmptyFile(outputDir + "/SUCCESS");
+    }
+
+private:
+    void write(const std::string& path, const std::vector<FlatCountTable>& shards,
+               const std::vector<std::vector<std::uint32_t>>& orders) {
+        std::vector<std::size_t> pos(shards.size(), 0);
+        auto key = [&](std::size_t s) { return shards[s].entries().key(orders[s][pos[s]]); };
+        auto less = [&](std::size_t a, std::size_t b) { return key(a) < key(b); };
+
+        LoserTree<decltype(less)> tree(shards.size(), less);
+        std::vector<bool> exhausted(shards.size());
+        for (std::size_t s = 0; s < shards.size(); ++s) exhausted[s] = orders[s].empty();
+        tree.build(exhausted);
+
+        AppendSink out = fm_.openAppend(path, /*truncate*/ true);
+        while (!tree.empty()) {
+            const std::size_t s = tree.top();
+            const std::uint32_t i = orders[s][pos[s]];
+            const std::string_view k = shards[s].entries().key(i);
+            out.writeRecord(k, reduce_(k, shards[s].entries().count(i)));
+            tree.replay(++pos[s] == orders[s].size());
+        }
+    }
+
+    // Runs body on n threads (the caller is one of them); the first
+    // exception thrown by any of them is rethrown once all have finished
+    template <class Body>
+    static void runOnThreads(unsigned n, Body&& body) {
+        std::exception_ptr error;
+        std::mutex         errorMu;
+        auto guarded = [&] {
+            try {
+                body();
+            } catch (...) {
+                std::lock_guard<std::mutex> lk(errorMu);
+                if (!error) error = std::current_exception();
+            }
+        };
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < n; ++t) pool.emplace_back(guarded);
+        guarded();
+        for (auto& th : pool) th.join();
+        if (error) std::rethrow_exception(error);
+    }
+
+    FileManager& fm_;
+    MapFn        map_;
+    ReduceFn     reduce_;
+    CombineFn    combine_;
+    unsigned     numThreads_;
+};
+
+// ------------------------------------------------------------------
+// Word count as a Job: lowercase ASCII tokens, summed
+// ------------------------------------------------------------------
+struct WordCountMap {
+    Tokenizer tokenizer;   // per-thread copy reuses its fold buffer
+
+    template <class Emit>
+    void operator()(std::string_view line, Emit& emit) {
+        tokenizer.forEachToken(line, [&](std::string_view token) { emit(token, 1); });
+    }
+};
+
+struct IdentityReduce {
+    int operator()(std::string_view, int value) const { return value; }
+};
+
+using WordCountJob = Job<WordCountMap, IdentityReduce>;
+
+} // namespace mr
@@ -0,0 +1,105 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace mr {
+
+// ------------------------------------------------------------------
+// KVBuffer: structure-of-arrays buffer of (key, count) records.
+// All key bytes live back to back in one arena; record i's key is
+// arena[offsets[i], offsets[i+1]). Counts, key hashes and partition ids
+// sit in parallel arrays, so scans touch only the column they need and
+// pushing a key never allocates on its own. clear() keeps every
+// capacity, so a buffer that is filled and flushed repeatedly stops
+// allocating after the first round.
+// ------------------------------------------------------------------
+class KVBuffer {
+public:
+    using Count = int;
+
+    // Key offsets and record indices are 32-bit, so one fill holds at most
+    // kMaxKeyBytes (4 GiB) of key bytes and kMaxRecords records. push()
+    // throws std::length_error past that; callers that can spill check
+    // fits() first.
+    static constexpr std::size_t kMaxKeyBytes = UINT32_MAX;
+    static constexpr std::size_t kMaxRecords  = UINT32_MAX - 1;
+
+    KVBuffer() { offsets_.push_back(0); }
+
+    std::size_t size() const      { return counts_.size(); }
+    bool        empty() const     { return counts_.empty(); }
+    std::size_t keyBytes() const  { return arena_.size(); }
+
+    // Approximate heap footprint of the current contents
+    std::size_t memoryBytes() const {
+        return arena_.size() + size() * (sizeof(std::uint32_t) * 2 + sizeof(Count) + sizeof(std::uint64_t));
+    }
+
+    // Whether a key of keySize bytes can still be pushed
+    bool fits(std::size_t keySize) const {
+        return keySize <= kMaxKeyBytes - arena_.size() && size() < kMaxRecords;
+    }
+
+    void reserve(std::size_t records, std::size_t keyBytes) {
+        arena_.reserve(keyBytes);
+        offsets_.reserve(records + 1);
+        counts_.reserve(records);
+        hashes_.reserve(records);
+        parts_.reserve(records);
+    }
+
+    std::size_t push(std::string_view key, Count count,
+                     std::uint64_t hash = 0, std::uint32_t partition = 0) {
+        if (!fits(key.size())) throw std::length_error("KVBuffer: more than 4 GiB of keys in one fill");
+        const std::size_t at = arena_.size();
+        arena_.resize(at + key.size());
+        if (!key.empty()) std::memcpy(arena_.data() + at, key.data(), key.size());
+        offsets_.push_back(static_cast<std::uint32_t>(arena_.size()));
+        counts_.push_back(count);
+        hashes_.push_back(hash);
+        parts_.push_back(partition);
+        return counts_.size() - 1;
+    }
+
+    std::string_view key(std::size_t i) const {
+        return std::string_view(arena_.data() + offsets_[i], offsets_[i + 1] - offsets_[i]);
+    }
+    Count&        count(std::size_t i)           { return counts_[i]; }
+    Count         count(std::size_t i) const     { return counts_[i]; }
+    std::uint64_t hash(std::size_t i) const      { return hashes_[i]; }
+    std::uint32_t partition(std::size_t i) const { return parts_[i]; }
+
+    void clear() {
+        arena_.clear();
+        offsets_.resize(1);
+        counts_.clear();
+        hashes_.clear();
+        parts_.clear();
+    }
+
+    // Record indices ordered by (partition, key); equal keys end up adjacent
+    // so callers can group or combine them in one pass. order is reused.
+    void sortedOrder(std::vector<std::uint32_t>& order) const {
+        order.resize(size());
+        std::iota(order.begin(), order.end(), 0u);
+        std::sort(order.begin(), order.end(), [this](std::uint32_t a, std::uint32_t b) {
+            if (parts_[a] != parts_[b]) return parts_[a] < parts_[b];
+            return key(a) < key(b);
+        });
+    }
+
+private:
+    std::vector<char>          arena_;
+    std::vector<std::uint32_t> offsets_;   // size() + 1 entries; 32-bit, see kMaxKeyBytes
+    std::vector<Count>         counts_;
+    std::vector<std::uint64_t> hashes_;
+    std::vector<std::uint32_t> parts_;
+};
+
+} // namespace mr
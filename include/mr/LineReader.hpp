@@ -0,0 +1,93 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mr {
+
+// ------------------------------------------------------------------
+// LineReader: streams a text file line by line without materializing it.
+// The file is memory-mapped through a sliding window of fixed size; if
+// mapping is unavailable it falls back to buffered reads into a reusable
+// window. Each line is handed out as a string_view into that window, so
+// reading costs no per-line allocation and memory stays constant.
+//
+// A reader may be restricted to a byte range [offset, offset + length):
+// it then yields exactly the lines whose first byte lies in that range,
+// so adjacent ranges of one file partition its lines with no overlap.
+// ------------------------------------------------------------------
+class LineReader {
+public:
+    static constexpr std::size_t   kDefaultWindowBytes = 16u << 20; // 16 MiB
+    static constexpr std::uint64_t kToEnd = ~std::uint64_t(0);
+
+    explicit LineReader(const std::string& path,
+                        std::size_t windowBytes = kDefaultWindowBytes);
+
+    // Range reader (see above); length == kToEnd reads to end of file
+    LineReader(const std::string& path, std::uint64_t offset, std::uint64_t length,
+               std::size_t windowBytes = kDefaultWindowBytes);
+    ~LineReader();
+
+    LineReader(const LineReader&) = delete;
+    LineReader& operator=(const LineReader&) = delete;
+
+    bool isOpen() const { return open_; }
+    bool isMapped() const { return mapped_; }
+
+    // Next line without its terminator ("\n" or "\r\n").
+    // The view stays valid only until the following call.
+    bool next(std::string_view& line);
+
+    // Raw byte access for binary records, with no line alignment: seek()
+    // moves to an absolute offset, read() hands out the next n bytes as one
+    // view (valid until the following call), or false when fewer than n
+    // bytes are left in the file or range.
+    void seek(std::uint64_t offset);
+    bool read(std::size_t n, std::string_view& bytes);
+
+private:
+    bool openMapped(const std::string& path);
+    bool remap(std::uint64_t offset);
+    void unmap();
+    void closeMapped();
+
+    bool nextMapped(std::string_view& line);
+    bool nextBuffered(std::string_view& line);
+    bool readMapped(std::size_t n, std::string_view& bytes);
+    bool readBuffered(std::size_t n, std::string_view& bytes);
+    void alignToRange(std::uint64_t offset);
+
+    static std::string_view stripCR(std::string_view line);
+
+    bool          open_   = false;
+    bool          mapped_ = false;
+    std::size_t   window_ = kDefaultWindowBytes;
+    std::uint64_t fileSize_ = 0;
+    std::uint64_t limit_    = kToEnd; // lines must start before this offset
+
+    // --- mapped mode: [viewOff_, viewOff_ + viewLen_) of the file is visible
+    std::uint64_t viewOff_ = 0;
+    std::size_t   viewLen_ = 0;
+    const char*   view_    = nullptr;
+    std::uint64_t pos_     = 0;     // absolute offset of the next line
+#ifdef _WIN32
+    void* file_    = nullptr;       // HANDLE
+    void* mapping_ = nullptr;       // HANDLE
+#else
+    int   fd_      = -1;
+#endif
+
+    // --- buffered fallback: unread bytes live in buf_[begin_, end_)
+    std::ifstream     in_;
+    std::vector<char> buf_;
+    std::size_t       begin_ = 0;
+    std::size_t       end_   = 0;
+    bool              eof_   = false;
+    std::uint64_t     bufPos_ = 0;  // absolute offset of buf_[begin_]
+};
+
+} // namespace mr
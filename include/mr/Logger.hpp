@@ -14,8 +14,10 @@ public:
 
     Logger(FileManager& fm, std::string logPath, Level min=Level::Info)
         : fm_(fm), path_(std::move(logPath)), minLevel_(min) {
-        // Ensure directory exists; FileManager handles parent creation
-        fm_.appendLine(path_, banner("LOGGER STARTED"));
+        // Ensure directory exists; FileManager handles parent creation.
+        // The log stays open and buffered; warnings and errors flush eagerly.
+        sink_ = fm_.openAppend(path_, /*truncate*/ false, kLogBufferBytes);
+        sink_.writeLine(banner("LOGGER STARTED"));
     }
 
     void info (const std::string& m) { write(Level::Info,  "INFO ", m); }
@@ -24,7 +26,14 @@ public:
 
     void setLevel(Level lvl) { minLevel_ = lvl; }
 
+    void flush() {
+        std::lock_guard<std::mutex> lk(mu_);
+        sink_.flush();
+    }
+
 private:
+    static constexpr std::size_t kLogBufferBytes = 64 * 1024;
+
     static std::string nowIso() {
         using namespace std::chrono;
         const auto t = system_clock::to_time_t(system_clock::now());
@@ -48,11 +57,13 @@ private:
     void write(Level lvl, const char* tag, const std::string& m) {
         if (lvl < minLevel_) return;
         std::lock_guard<std::mutex> lk(mu_);
-        fm_.appendLine(path_, nowIso() + " [" + tag + "] " + m);
+        sink_.writeLine(nowIso() + " [" + tag + "] " + m);
+        if (lvl != Level::Info) sink_.flush();
     }
 
     FileManager&   fm_;
     std::string    path_;
+    AppendSink     sink_;
     std::mutex     mu_;
     Level          minLevel_;
 };
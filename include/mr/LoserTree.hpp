@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace mr {
+
+// ------------------------------------------------------------------
+// LoserTree: tournament tree for k-way merging of sorted sources.
+// Sources are identified by index; less(a, b) compares the current heads
+// of live sources a and b. Each internal node keeps the loser of its
+// match, so after the winning source advances only one leaf-to-root path
+// (log2 k comparisons) is replayed, against a binary heap's ~2 log2 k.
+// Equal heads come out in unspecified order.
+//
+//   LoserTree<Less> lt(k, less);
+//   lt.build(exhausted);             // exhausted[i]: source i is empty
+//   while (!lt.empty()) {
+//       std::size_t s = lt.top();    // consume head of s, advance s
+//       lt.replay(sourceSEmpty);
+//   }
+// ------------------------------------------------------------------
+template <class Less>
+class LoserTree {
+public:
+    LoserTree(std::size_t k, Less less)
+        : k_(k), less_(std::move(less)), tree_(k ? k : 1, 0), done_(k, true) {}
+
+    std::size_t size() const { return k_; }
+
+    void build(const std::vector<bool>& exhausted) {
+        done_ = exhausted;
+        done_.resize(k_, true);
+        if (k_ <= 1) {
+            tree_[0] = 0;
+            return;
+        }
+        // Leaves live at virtual positions k..2k-1; node n plays 2n vs 2n+1
+        std::vector<std::size_t> winner(2 * k_);
+        for (std::size_t i = 0; i < k_; ++i) winner[k_ + i] = i;
+        for (std::size_t n = k_ - 1; n >= 1; --n) {
+            const std::size_t a = winner[2 * n], b = winner[2 * n + 1];
+            if (beats(a, b)) { winner[n] = a; tree_[n] = b; }
+            else             { winner[n] = b; tree_[n] = a; }
+        }
+        tree_[0] = winner[1];
+    }
+
+    bool empty() const { return k_ == 0 || done_[tree_[0]]; }
+
+    // Source holding the smallest head; only valid while !empty()
+    std::size_t top() const { return tree_[0]; }
+
+    // Call after top() advanced to its next head (exhausted: it has none)
+    void replay(bool exhausted) {
+        std::size_t w = tree_[0];
+        done_[w] = exhausted;
+        for (std::size_t n = (k_ + w) / 2; n >= 1; n /= 2) {
+            if (beats(tree_[n], w)) std::swap(tree_[n], w);
+        }
+        tree_[0] = w;
+    }
+
+private:
+    bool beats(std::size_t a, std::size_t b) const {
+        if (done_[a]) return false;
+        if (done_[b]) return true;
+        return less_(a, b);
+    }
+
+    std::size_t              k_;
+    Less                     less_;
+    std::vector<std::size_t> tree_;   // [0] winner, [1..k-1] losers
+    std::vector<bool>        done_;
+};
+
+} // namespace mr
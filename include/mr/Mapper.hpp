@@ -1,6 +1,15 @@
 #pragma once 
 #include "FileManager.hpp"
+#include "FlatCountTable.hpp"
+#include "KVBuffer.hpp"
+#include "PartitionFiles.hpp"
+#include "RecordFormat.hpp"
+#include "Partitioner.hpp"
+#include "Tokenizer.hpp"
+#include <functional>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <utility>
 
@@ -18,19 +27,81 @@ public:
            int mapperId,
            int numReducers);
 
-    void map(const std::string& fileName, const std::string& line);
-    void flush();
+    // Thread-per-Mapper constructor: several Mappers append to one shared
+    // partition sink (one file or stream per reducer bucket per worker).
+    Mapper(FileManager& fm,
+           std::shared_ptr<PartitionSink> files,
+           std::size_t flushThreshold);
+
+    // Hands already exported records to the partition files (flush() also
+    // exports what is still buffered and pushes the files to disk).
+    ~Mapper();
+
+    // In-mapper combining: counts are folded per word in memory and the
+    // partial values are spilled whenever the table's estimated size
+    // passes memoryBudgetBytes (0 turns combining off again). combine
+    // folds two values of a word (associative and commutative); empty
+    // means a sum. Sorted runs fold equal keys with it as well.
+    using CombineFn = std::function<int(std::string_view word, int a, int b)>;
+    static constexpr std::size_t kDefaultCombineBudget = 64u << 20; // 64 MiB
+    void enableCombiner(std::size_t memoryBudgetBytes = kDefaultCombineBudget,
+                        CombineFn combine = {});
+
+    // Sort-based shuffle: every export is sorted by (bucket, key), equal
+    // keys are combined (summed without a combine function), and each
+    // bucket's share is handed to the sink as one sorted run
+    // (PartitionSink::appendRun). Without the combiner, pairs
+    // are exported once they take runBufferBytes instead of every
+    // flushThreshold pairs, so runs stay long.
+    static constexpr std::size_t kDefaultRunBufferBytes = 16u << 20; // 16 MiB
+    void enableSortedRuns(std::size_t runBufferBytes = kDefaultRunBufferBytes);
+
+    // Bucket choice for exported pairs (HashPartitioner unless replaced).
+    // Must have numReducers partitions; throws std::invalid_argument otherwise.
+    void setPartitioner(std::shared_ptr<const Partitioner> partitioner);
+
+    // line may point into a LineReader window; it is not retained
+    void map(const std::string& fileName, std::string_view line);
+    // One already extracted pair (map() emits every token with count 1);
+    // buffered, combined and partitioned like the tokens of map()
+    void emit(std::string_view word, int count);
+    void flush();    // export remaining pairs and push partition files to disk
     void exportKV(); // per spec: export intermediate key-value pairs
 
 private:
+    void exportRecord(std::size_t bucket, std::string_view word, int count);
+    void exportSortedRuns();
+    void pushBlocks();
+    int  combine(std::string_view word, int a, int b) const {
+        return combineFn_ ? combineFn_(word, a, b) : a + b;
+    }
+
     FileManager& fileManager_;
     std::string tempDir_;
-    std::vector<std::pair<std::string, int>> buffer_;
+    KVBuffer    buffer_;    // uncombined pairs, hash and bucket precomputed
     std::size_t flushThreshold_;
+    Tokenizer   tokenizer_; // reuses its fold buffer across lines
 
     // New fields:
     int mapperId_     = 0;
     int numReducers_  = 1;
+    std::shared_ptr<const Partitioner> partitioner_;
+
+    // Combiner state (enabled when combineBudget_ > 0)
+    FlatCountTable combined_;  // memoryBytes() is what the budget is checked against
+    std::size_t combineBudget_ = 0;
+    CombineFn   combineFn_;     // empty: sum
+
+    // Sorted-run state (enabled when runBufferBytes_ > 0)
+    std::size_t                runBufferBytes_ = 0;
+    std::vector<std::uint32_t> order_;  // reused sort permutation
+    RecordBuffer               run_{ intermediateFormat(), true }; // run being formatted (front-coded)
+
+    // Records are formatted into a contiguous block per reducer bucket and
+    // handed to the (possibly shared) partition files once a block fills.
+    static constexpr std::size_t kBlockBytes = 64u << 10; // 64 KiB
+    std::shared_ptr<PartitionSink> files_;
+    std::vector<RecordBuffer>      blocks_;
 };
 
 } // namespace mr
@@ -0,0 +1,84 @@
+#pragma once
+#include "FileManager.hpp"
+#include "InputSplit.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mr {
+
+// ------------------------------------------------------------------
+// PartitionSink: where a mapper's formatted record blocks go, one
+// stream per reducer bucket. Blocks always end on a record boundary
+// and append() must be safe to call from several Mappers at once.
+// ------------------------------------------------------------------
+class PartitionSink {
+public:
+    virtual ~PartitionSink() = default;
+
+    virtual int mapperId() const = 0;
+    virtual std::size_t numPartitions() const = 0;
+
+    virtual void append(std::size_t bucket, std::string_view block) = 0;
+    // One key-sorted run, kept contiguous; sinks that index runs record
+    // where it lies (default: a plain append)
+    virtual void appendRun(std::size_t bucket, std::string_view run) { append(bucket, run); }
+    // Push whatever is still buffered to its destination
+    virtual void flush() = 0;
+};
+
+// Sorted-run index written next to a partition file that holds sorted
+// runs back to back: "<partition file>.runs", one "offset<TAB>length"
+// line per run
+std::string runIndexPath(const std::string& partitionPath);
+
+// The runs of a partition file as byte ranges of it; empty when the file
+// has no run index (unsorted records)
+std::vector<InputSplit> readRunIndex(const std::string& partitionPath);
+
+// ------------------------------------------------------------------
+// PartitionFiles: the tempDir/m<mapperId>_r<bucket>.txt writers of one
+// mapper. Every bucket's file is truncated when first opened (on first
+// use, or by flush() for buckets that got nothing) and kept open, so a
+// mapper rerun into the same tempDir never sees a previous run's records
+// or run index.
+// Callers hand over whole blocks of records; a block is appended under
+// its bucket's lock, so several Mappers (one per thread) can share one
+// set and still produce a single file per reducer bucket. Sorted runs
+// (appendRun) are indexed and the index is written on flush().
+// ------------------------------------------------------------------
+class PartitionFiles : public PartitionSink {
+public:
+    static constexpr std::size_t kSinkBufferBytes = 256u << 10; // 256 KiB
+
+    PartitionFiles(FileManager& fm, const std::string& tempDir, int mapperId, int numReducers);
+
+    int mapperId() const override { return mapperId_; }
+    std::size_t numPartitions() const override { return paths_.size(); }
+    const std::string& path(std::size_t bucket) const { return paths_[bucket]; }
+
+    void append(std::size_t bucket, std::string_view block) override;
+    void appendRun(std::size_t bucket, std::string_view run) override;
+    void flush() override;
+
+private:
+    AppendSink& sinkFor(std::size_t bucket); // caller holds the bucket lock
+    void writeRunIndex(std::size_t bucket);
+
+    FileManager&                 fm_;
+    int                          mapperId_;
+    std::vector<std::string>     paths_;
+    std::vector<AppendSink>      sinks_;
+    std::unique_ptr<std::mutex[]> locks_;
+
+    // Sorted-run bookkeeping per bucket: file size so far and the run ranges
+    std::vector<std::uint64_t>            written_;
+    std::vector<std::vector<InputSplit>>  runs_;
+    std::vector<char>                     runsDirty_;
+};
+
+} // namespace mr
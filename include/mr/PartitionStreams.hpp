@@ -0,0 +1,65 @@
+#pragma once
+#include "PartitionFiles.hpp"
+#include <winsock2.h>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace mr {
+
+// ------------------------------------------------------------------
+// Push shuffle wire format. A mapper opens one connection per reducer
+// and sends "PUSH|<mapperId>\n", then frames: a 4-byte big-endian
+// length followed by that many bytes of whole records (binary blocks or
+// text lines, see RecordFormat.hpp).
+// A zero-length frame marks the end of that mapper's stream.
+// ------------------------------------------------------------------
+inline constexpr const char* kPushHello = "PUSH|";
+
+// "host:port,host:port,..." -> endpoint i (reducer or mapper stub i)
+std::vector<std::pair<std::string, int>> parseEndpoints(const std::string& csv);
+
+// false once the connection is broken
+bool sendFrame(SOCKET s, std::string_view payload);
+// Next frame into payload (empty: end of stream); false on a broken connection
+bool recvFrame(SOCKET s, std::string& payload);
+
+// ------------------------------------------------------------------
+// PartitionStreams: the push-shuffle PartitionSink. Every block goes to
+// its reducer as one frame the moment the Mapper hands it over, so
+// reducers aggregate while the map is still running. Sends block while
+// a reducer falls behind (TCP flow control is the backpressure).
+// Connection failures throw std::runtime_error once; later appends are
+// dropped, since the worker is about to fail anyway.
+// ------------------------------------------------------------------
+class PartitionStreams : public PartitionSink {
+public:
+    PartitionStreams(int mapperId, const std::vector<std::pair<std::string, int>>& reducers);
+    ~PartitionStreams() override;
+    PartitionStreams(const PartitionStreams&) = delete;
+    PartitionStreams& operator=(const PartitionStreams&) = delete;
+
+    int mapperId() const override { return mapperId_; }
+    std::size_t numPartitions() const override { return sockets_.size(); }
+
+    void append(std::size_t bucket, std::string_view block) override;
+    void flush() override {} // frames are sent unbuffered
+
+    // Send the end-of-stream frame to every reducer and close
+    void finish();
+
+private:
+    void closeAll();
+
+    int                           mapperId_;
+    std::vector<SOCKET>           sockets_;
+    std::unique_ptr<std::mutex[]> locks_;
+    std::atomic<bool>             broken_{ false };
+};
+
+} // namespace mr
@@ -0,0 +1,118 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Hash.hpp"
+
+namespace mr {
+
+// ------------------------------------------------------------------
+// Partitioner: decides which reducer bucket a key is shuffled to.
+// ------------------------------------------------------------------
+class Partitioner {
+public:
+    explicit Partitioner(std::size_t numPartitions)
+        : numPartitions_(numPartitions ? numPartitions : 1) {}
+    virtual ~Partitioner() = default;
+
+    std::size_t numPartitions() const { return numPartitions_; }
+    virtual std::size_t partition(std::string_view key) const = 0;
+
+    // Same as partition(key) for callers that already hold hashKey(key)
+    virtual std::size_t partitionHashed(std::string_view key, std::uint64_t /*hash*/) const {
+        return partition(key);
+    }
+
+private:
+    std::size_t numPartitions_;
+};
+
+// Default: spread keys evenly by hash (no order between buckets).
+// Uses the platform-stable shuffle hash, so mixed Windows/Linux workers agree.
+class HashPartitioner : public Partitioner {
+public:
+    using Partitioner::Partitioner;
+    std::size_t partition(std::string_view key) const override {
+        return reduceHash(hashKey(key), numPartitions());
+    }
+    std::size_t partitionHashed(std::string_view, std::uint64_t hash) const override {
+        return reduceHash(hash, numPartitions());
+    }
+};
+
+// ------------------------------------------------------------------
+// RangePartitioner: bucket r holds the contiguous key range
+// [bounds[r-1], bounds[r]), so sorted reducer outputs concatenated in
+// bucket order are globally sorted. bounds has numPartitions - 1 entries,
+// strictly increasing.
+// ------------------------------------------------------------------
+class RangePartitioner : public Partitioner {
+public:
+    explicit RangePartitioner(std::vector<std::string> bounds)
+        : Partitioner(bounds.size() + 1), bounds_(std::move(bounds)) {}
+
+    std::size_t partition(std::string_view key) const override {
+        return static_cast<std::size_t>(
+            std::upper_bound(bounds_.begin(), bounds_.end(), key,
+                             [](std::string_view k, const std::string& b) { return k < b; }) -
+            bounds_.begin());
+    }
+
+    const std::vector<std::string>& bounds() const { return bounds_; }
+
+private:
+    std::vector<std::string> bounds_;
+};
+
+// Pick up to numPartitions - 1 split points at the quantiles of a key
+// sample (TeraSort style). Sampling occurrences rather than distinct keys
+// gives each bucket a similar share of records. Bounds are strictly
+// increasing and above the smallest sample: a quantile that lands on the
+// previous bound (a hot key) moves to the next distinct key instead, and
+// a sample with too few distinct keys yields fewer bounds, so callers
+// size the job by bounds.size() + 1 rather than numPartitions.
+inline std::vector<std::string> chooseRangeBounds(std::vector<std::string> samples,
+                                                  std::size_t numPartitions) {
+    std::vector<std::string> bounds;
+    if (numPartitions < 2 || samples.empty()) return bounds;
+    std::sort(samples.begin(), samples.end());
+    bounds.reserve(numPartitions - 1);
+    for (std::size_t i = 1; i < numPartitions; ++i) {
+        const std::string& lower = bounds.empty() ? samples.front() : bounds.back();
+        std::size_t pos = i * samples.size() / numPartitions;
+        if (!(lower < samples[pos])) {
+            pos = static_cast<std::size_t>(
+                std::upper_bound(samples.begin(), samples.end(), lower) - samples.begin());
+            if (pos == samples.size()) break;   // no distinct keys left
+        }
+        bounds.push_back(samples[pos]);
+    }
+    return bounds;
+}
+
+// Bounds file: one split point per line, in bucket order
+inline bool writeRangeBounds(const std::string& path, const std::vector<std::string>& bounds) {
+    std::ofstream out(path, std::ios::trunc | std::ios::binary);
+    if (!out) return false;
+    for (auto& b : bounds) out << b << "\n";
+    return static_cast<bool>(out);
+}
+
+inline std::vector<std::string> readRangeBounds(const std::string& path) {
+    std::vector<std::string> bounds;
+    std::ifstream in(path, std::ios::binary);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        bounds.push_back(line);
+    }
+    return bounds;
+}
+
+} // namespace mr
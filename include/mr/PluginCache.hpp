@@ -0,0 +1,163 @@
+#pragma once
+#include "Interfaces.hpp"
+#include "PluginLoader.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace mr {
+
+// ------------------------------------------------------------------
+// PluginSet: one loaded generation of a Map/Reduce plugin pair and its
+// idle IMapper / IReducer / ICombiner instances. Leased instances go back to the
+// idle list instead of being destroyed, and keep the libraries loaded
+// while in use, so a set outlives a reload until its last lease ends.
+// ------------------------------------------------------------------
+class PluginSet : public std::enable_shared_from_this<PluginSet> {
+public:
+    PluginSet(PluginHandles ph, std::vector<std::string> shadowFiles)
+        : ph_(ph), shadowFiles_(std::move(shadowFiles)) {}
+
+    ~PluginSet() {
+        for (IMapper* m : idleMappers_)   ph_.destroyMapper(m);
+        for (IReducer* r : idleReducers_) ph_.destroyReducer(r);
+        for (ICombiner* c : idleCombiners_) ph_.destroyCombiner(c);
+        freePlugins(ph_);
+        std::error_code ec;
+        for (const auto& f : shadowFiles_) std::filesystem::remove(f, ec);
+    }
+
+    PluginSet(const PluginSet&) = delete;
+    PluginSet& operator=(const PluginSet&) = delete;
+
+    const PluginHandles& handles() const { return ph_; }
+
+    // Idle instance if there is one, else a new one from the factory
+    std::shared_ptr<IMapper> leaseMapper() {
+        return lease(idleMappers_, ph_.createMapper);
+    }
+    std::shared_ptr<IReducer> leaseReducer() {
+        return lease(idleReducers_, ph_.createReducer);
+    }
+    // nullptr when Reduce.dll exports no combiner
+    std::shared_ptr<ICombiner> leaseCombiner() {
+        if (!ph_.createCombiner) return nullptr;
+        return lease(idleCombiners_, ph_.createCombiner);
+    }
+
+private:
+    template <class T, class CreateFn>
+    std::shared_ptr<T> lease(std::vector<T*>& idle, CreateFn create) {
+        T* p = nullptr;
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            if (!idle.empty()) {
+                p = idle.back();
+                idle.pop_back();
+            }
+        }
+        if (!p) p = create();
+        if (!p) throw std::runtime_error("Plugin factory returned null");
+
+        auto self = shared_from_this();
+        return std::shared_ptr<T>(p, [self, &idle](T* q) {
+            std::lock_guard<std::mutex> lk(self->mu_);
+            idle.push_back(q);
+        });
+    }
+
+    PluginHandles            ph_;
+    std::vector<std::string> shadowFiles_;
+    std::mutex               mu_;
+    std::vector<IMapper*>    idleMappers_;
+    std::vector<IReducer*>   idleReducers_;
+    std::vector<ICombiner*>  idleCombiners_;
+};
+
+// ------------------------------------------------------------------
+// PluginCache: keeps plugin pairs loaded across the jobs of a long-lived
+// process (keyed by plugin directory). acquire() hands out the current
+// PluginSet and hot-reloads it when either library's size or modification
+// time changed since it was loaded; jobs still running keep the old set.
+//
+// Libraries are loaded from copies in shadowDir, so the originals can be
+// replaced while loaded (Windows locks loaded DLLs, and dlopen would hand
+// back the image already loaded from the same path).
+// ------------------------------------------------------------------
+class PluginCache {
+public:
+    explicit PluginCache(std::string shadowDir) : shadowDir_(std::move(shadowDir)) {}
+
+    std::shared_ptr<PluginSet> acquire(const std::string& dllDir) {
+        const std::string mapPath = pluginPath(dllDir, "Map");
+        const std::string redPath = pluginPath(dllDir, "Reduce");
+        const Stamp mapStamp = stampOf(mapPath), redStamp = stampOf(redPath);
+
+        std::lock_guard<std::mutex> lk(mu_);
+        Entry& e = entries_[dllDir];
+        if (e.set && e.map == mapStamp && e.reduce == redStamp) return e.set;
+
+        std::filesystem::create_directories(shadowDir_);
+        const std::string tag = std::to_string(currentProcessId()) + "_" + std::to_string(generation_++);
+        std::vector<std::string> shadows = { shadowCopy(mapPath, tag), shadowCopy(redPath, tag) };
+
+        PluginHandles ph;
+        try {
+            ph = loadPluginFiles(shadows[0], shadows[1]);
+        } catch (...) {
+            std::error_code ec;
+            for (const auto& f : shadows) std::filesystem::remove(f, ec);
+            throw;
+        }
+        e.set    = std::make_shared<PluginSet>(ph, std::move(shadows));
+        e.map    = mapStamp;
+        e.reduce = redStamp;
+        return e.set;
+    }
+
+    // Drops the cached sets; they unload once no job uses them
+    void clear() {
+        std::lock_guard<std::mutex> lk(mu_);
+        entries_.clear();
+    }
+
+private:
+    struct Stamp {
+        std::filesystem::file_time_type time{};
+        std::uintmax_t                  size = 0;
+        bool operator==(const Stamp& o) const { return time == o.time && size == o.size; }
+    };
+    struct Entry {
+        std::shared_ptr<PluginSet> set;
+        Stamp                      map, reduce;
+    };
+
+    static Stamp stampOf(const std::string& path) {
+        Stamp s;
+        s.time = std::filesystem::last_write_time(path); // throws if missing
+        s.size = std::filesystem::file_size(path);
+        return s;
+    }
+
+    std::string shadowCopy(const std::string& path, const std::string& tag) const {
+        const std::filesystem::path src(path);
+        const std::filesystem::path dst =
+            std::filesystem::path(shadowDir_) / (tag + "_" + src.filename().string());
+        std::filesystem::copy_file(src, dst, std::filesystem::copy_options::overwrite_existing);
+        return dst.string();
+    }
+
+    std::string                  shadowDir_;
+    std::mutex                   mu_;
+    std::map<std::string, Entry> entries_;
+    unsigned                     generation_ = 0;
+};
+
+} // namespace mr
@@ -1,37 +1,100 @@
 #pragma once
 #include "Interfaces.hpp"
 #include "FileManager.hpp"
+#include "Mapper.hpp"
+#include "PartitionFiles.hpp"
+#include "RecordFormat.hpp"
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <string_view>
 
 namespace mr {
 
+// Pairs emitted by a plugin mapper go through a builtin Mapper: buffered
+// in memory, hash-partitioned over the sink's buckets and written as
+// whole blocks, so an emit is a copy into a buffer rather than I/O.
 class MapContextAdapter : public IMapContext {
 public:
-    MapContextAdapter(FileManager& fm, std::string tempDir)
-        : fm_(fm), tempDir_(std::move(tempDir)), tmpPath_(tempDir_ + "/intermediate.txt") {
-        fm_.ensureDir(tempDir_);
-    }
+    static constexpr std::size_t kFlushPairs = 2048;
+
+    MapContextAdapter(FileManager& fm, std::shared_ptr<PartitionSink> sink)
+        : mapper_(fm, std::move(sink), kFlushPairs) {}
+
     void emit(const Word& w, Count c) override {
-        fm_.appendLine(tmpPath_, w + "\t" + std::to_string(c));
+        mapper_.emit(w, c);
+    }
+    void emitBatch(const std::string_view* words, const Count* counts, std::size_t n) override {
+        for (std::size_t i = 0; i < n; ++i) mapper_.emit(words[i], counts[i]);
+    }
+
+    // Sums counts per word before they are written; only valid when the
+    // job's reducer sums (see Mapper::enableCombiner)
+    void enableCombiner(std::size_t memoryBudgetBytes = Mapper::kDefaultCombineBudget) {
+        mapper_.enableCombiner(memoryBudgetBytes);
+    }
+    // Folds counts per word with the plugin's combiner instead; combiner
+    // must outlive this context
+    void enableCombiner(ICombiner& combiner,
+                        std::size_t memoryBudgetBytes = Mapper::kDefaultCombineBudget) {
+        mapper_.enableCombiner(memoryBudgetBytes, [&combiner](std::string_view w, int a, int b) {
+            return combiner.combine(w, a, b);
+        });
     }
+
+    // Must be called before anything reads the partition files
+    void flush() { mapper_.flush(); }
 private:
-    FileManager& fm_;
-    std::string  tempDir_;
-    std::string  tmpPath_;
+    Mapper mapper_;
 };
 
+// Results are formatted into a buffer and written in large appends.
+// format: Text for user-facing output, Binary for files merged later.
+// sorted() tells whether the keys came in key order, i.e. whether the
+// file can be merged as one sorted run.
 class ReduceContextAdapter : public IReduceContext {
 public:
-    ReduceContextAdapter(FileManager& fm, std::string outputFile)
-        : fm_(fm), outFile_(std::move(outputFile)) {
-        fm_.writeAll(outFile_, ""); // truncate once before first write
+    static constexpr std::size_t kFlushBytes = 1u << 20; // 1 MiB
+
+    ReduceContextAdapter(FileManager& fm, std::string outputFile,
+                         RecordFormat format = RecordFormat::Text)
+        : fm_(fm), outFile_(std::move(outputFile)), records_(format) {
+        out_ = fm_.openAppend(outFile_, /*truncate*/ true); // truncate once before first write
     }
     void emit(const Word& w, Count total) override {
-        fm_.appendLine(outFile_, w + "\t" + std::to_string(total));
+        add(w, total);
+    }
+    void emitBatch(const std::string_view* words, const Count* totals, std::size_t n) override {
+        for (std::size_t i = 0; i < n; ++i) add(words[i], totals[i]);
     }
+    void flush() {
+        out_.write(records_.data());
+        records_.clear();
+        out_.flush();
+    }
+    const std::string& outputPath() const { return outFile_; }
+    bool sorted() const { return sorted_; }
 private:
+    void add(std::string_view w, Count total) {
+        if (sorted_) {
+            if (any_ && w < lastKey_) sorted_ = false;
+            lastKey_.assign(w.data(), w.size());
+            any_ = true;
+        }
+        records_.add(w, total);
+        if (records_.size() >= kFlushBytes) {
+            out_.write(records_.data());
+            records_.clear();
+        }
+    }
+
     FileManager& fm_;
     std::string  outFile_;
+    RecordBuffer records_;
+    AppendSink   out_;
+    std::string  lastKey_;          // tracked until the order breaks
+    bool         any_    = false;
+    bool         sorted_ = true;
 };
 
 } // namespace mr
@@ -1,55 +1,135 @@
 #pragma once
 #include "Interfaces.hpp"
-#include <windows.h>
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #define NOMINMAX
+  #include <windows.h>
+#else
+  #include <dlfcn.h>
+  #include <unistd.h>
+#endif
 #include <string>
 #include <stdexcept>
 
 namespace mr {
 
+#ifdef _WIN32
+using ModuleHandle = HMODULE;
+#else
+using ModuleHandle = void*;
+#endif
+
 struct PluginHandles {
-    HMODULE mapDLL = nullptr;
-    HMODULE reduceDLL = nullptr;
+    ModuleHandle mapDLL = nullptr;
+    ModuleHandle reduceDLL = nullptr;
 
     CreateMapperFn  createMapper = nullptr;
     DestroyMapperFn destroyMapper= nullptr;
     CreateReducerFn createReducer= nullptr;
     DestroyReducerFn destroyReducer= nullptr;
+    CreateCombinerFn  createCombiner = nullptr;   // null: Reduce.dll has no combiner
+    DestroyCombinerFn destroyCombiner= nullptr;
+
+    int mapAbi    = 1;   // MrPluginAbiVersion() of Map.dll, 1 if not exported
+    int reduceAbi = 1;   // MrPluginAbiVersion() of Reduce.dll, 1 if not exported
 };
 
-inline HMODULE loadDll(const std::string& path) {
-    HMODULE h = ::LoadLibraryA(path.c_str());
+// File of plugin `name` in dir as CMake names shared libraries:
+// Map.dll on Windows, libMap.so elsewhere
+inline std::string pluginPath(const std::string& dir, const std::string& name) {
+#ifdef _WIN32
+    return dir + "/" + name + ".dll";
+#else
+    return dir + "/lib" + name + ".so";
+#endif
+}
+
+inline unsigned long currentProcessId() {
+#ifdef _WIN32
+    return ::GetCurrentProcessId();
+#else
+    return static_cast<unsigned long>(::getpid());
+#endif
+}
+
+inline ModuleHandle loadDll(const std::string& path) {
+#ifdef _WIN32
+    ModuleHandle h = ::LoadLibraryA(path.c_str());
     if (!h) throw std::runtime_error("Failed to load DLL: " + path);
+#else
+    ModuleHandle h = ::dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!h) throw std::runtime_error("Failed to load plugin: " + path + " (" + ::dlerror() + ")");
+#endif
     return h;
 }
 
+inline void freeDll(ModuleHandle h) {
+#ifdef _WIN32
+    ::FreeLibrary(h);
+#else
+    ::dlclose(h);
+#endif
+}
+
+// nullptr when the DLL does not export name
 template <typename Fn>
-Fn loadSym(HMODULE h, const char* name) {
-    auto p = reinterpret_cast<Fn>(::GetProcAddress(h, name));
+Fn loadOptionalSym(ModuleHandle h, const char* name) {
+#ifdef _WIN32
+    return reinterpret_cast<Fn>(::GetProcAddress(h, name));
+#else
+    return reinterpret_cast<Fn>(::dlsym(h, name));
+#endif
+}
+
+template <typename Fn>
+Fn loadSym(ModuleHandle h, const char* name) {
+    auto p = loadOptionalSym<Fn>(h, name);
     if (!p) throw std::runtime_error(std::string("Missing symbol: ") + name);
     return p;
 }
 
-inline PluginHandles loadPlugins(const std::string& dllDir) {
+// Loads both libraries; throws if one is missing a factory or was built
+// against a newer plugin ABI than this host implements. The combiner
+// factories are optional, but come as a pair.
+inline PluginHandles loadPluginFiles(const std::string& mapDllPath, const std::string& redDllPath) {
     PluginHandles ph;
+    ph.mapDLL = loadDll(mapDllPath);
+    try {
+        ph.reduceDLL = loadDll(redDllPath);
 
-    // Expected names, or you can accept via CLI
-    const std::string mapDllPath = dllDir + "/Map.dll";
-    const std::string redDllPath = dllDir + "/Reduce.dll";
+        ph.createMapper   = loadSym<CreateMapperFn>(ph.mapDLL,  kCreateMapperSym);
+        ph.destroyMapper  = loadSym<DestroyMapperFn>(ph.mapDLL, kDestroyMapperSym);
+        ph.createReducer  = loadSym<CreateReducerFn>(ph.reduceDLL,  kCreateReducerSym);
+        ph.destroyReducer = loadSym<DestroyReducerFn>(ph.reduceDLL, kDestroyReducerSym);
 
-    ph.mapDLL    = loadDll(mapDllPath);
-    ph.reduceDLL = loadDll(redDllPath);
+        ph.createCombiner = loadOptionalSym<CreateCombinerFn>(ph.reduceDLL, kCreateCombinerSym);
+        if (ph.createCombiner)
+            ph.destroyCombiner = loadSym<DestroyCombinerFn>(ph.reduceDLL, kDestroyCombinerSym);
 
-    ph.createMapper   = loadSym<CreateMapperFn>(ph.mapDLL,  kCreateMapperSym);
-    ph.destroyMapper  = loadSym<DestroyMapperFn>(ph.mapDLL, kDestroyMapperSym);
-    ph.createReducer  = loadSym<CreateReducerFn>(ph.reduceDLL,  kCreateReducerSym);
-    ph.destroyReducer = loadSym<DestroyReducerFn>(ph.reduceDLL, kDestroyReducerSym);
+        if (auto abi = loadOptionalSym<PluginAbiVersionFn>(ph.mapDLL, kPluginAbiVersionSym))
+            ph.mapAbi = abi();
+        if (auto abi = loadOptionalSym<PluginAbiVersionFn>(ph.reduceDLL, kPluginAbiVersionSym))
+            ph.reduceAbi = abi();
 
+        if (ph.mapAbi > kPluginAbiVersion || ph.reduceAbi > kPluginAbiVersion)
+            throw std::runtime_error("Plugin built for ABI " +
+                                     std::to_string(ph.mapAbi > ph.reduceAbi ? ph.mapAbi : ph.reduceAbi) +
+                                     ", host implements " + std::to_string(kPluginAbiVersion));
+    } catch (...) {
+        if (ph.reduceDLL) freeDll(ph.reduceDLL);
+        freeDll(ph.mapDLL);
+        throw;
+    }
     return ph;
 }
 
+inline PluginHandles loadPlugins(const std::string& dllDir) {
+    return loadPluginFiles(pluginPath(dllDir, "Map"), pluginPath(dllDir, "Reduce"));
+}
+
 inline void freePlugins(PluginHandles& ph) {
-    if (ph.mapDLL)    ::FreeLibrary(ph.mapDLL), ph.mapDLL = nullptr;
-    if (ph.reduceDLL) ::FreeLibrary(ph.reduceDLL), ph.reduceDLL = nullptr;
+    if (ph.mapDLL)    freeDll(ph.mapDLL), ph.mapDLL = nullptr;
+    if (ph.reduceDLL) freeDll(ph.reduceDLL), ph.reduceDLL = nullptr;
 }
 
 } // namespace mr
@@ -0,0 +1,155 @@
+#pragma once
+#include "InputSplit.hpp"
+#include "LineReader.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace mr {
+
+// ------------------------------------------------------------------
+// Intermediate record formats (mapper -> reducer files, sort runs).
+//
+//  Text:   "word<TAB>count\n" lines, kept for debugging.
+//  Binary: a sequence of self-contained blocks. Each block is a 12-byte
+//          header followed by its records:
+//            header  = "\0MR" | flags (1 byte) | records (u32 LE) | payload bytes (u32 LE)
+//            record  = varint keyLen | key bytes | varint count
+//            front-coded record (flags & kFrontCoded, sorted runs):
+//                      varint shared prefix | varint suffixLen | suffix | varint count
+//          Front coding restarts with every block, so any block decodes
+//          on its own. Plain records decode in place (keys are views into
+//          the block).
+//
+// A text record never starts with a NUL byte, so readers tell the two
+// formats apart by the first byte and accept either.
+// MR_INTERMEDIATE_FORMAT=text switches writers to text (default binary).
+// ------------------------------------------------------------------
+enum class RecordFormat { Text, Binary };
+
+// Writer format chosen through MR_INTERMEDIATE_FORMAT (read once)
+RecordFormat intermediateFormat();
+
+inline constexpr std::size_t   kBlockHeaderBytes = 12;
+inline constexpr std::uint8_t  kFrontCoded       = 0x01;
+
+// Text record "word<TAB>count" (a single space is accepted too);
+// false for lines to skip (no separator, empty word or zero count)
+bool parseRecord(std::string_view line, std::string_view& word, int& count);
+
+// ------------------------------------------------------------------
+// RecordBuffer: formats records into contiguous bytes in the chosen
+// format. Binary records are cut into blocks of about kBlockPayloadBytes;
+// data() seals the open block, so its result can be written or sent as
+// is and a reader can start at its first byte. Front coding only pays
+// (and is only valid) when records are added in key order.
+// ------------------------------------------------------------------
+class RecordBuffer {
+public:
+    static constexpr std::size_t kBlockPayloadBytes = 64u << 10; // 64 KiB
+
+    explicit RecordBuffer(RecordFormat format = intermediateFormat(), bool frontCoded = false)
+        : format_(format), frontCoded_(frontCoded) {}
+
+    void add(std::string_view key, long long count);
+
+    std::size_t size() const { return bytes_.size(); }
+    bool empty() const { return bytes_.empty(); }
+
+    // Complete bytes; valid until the next add() or clear()
+    std::string_view data();
+    void clear();
+
+private:
+    void closeBlock();
+
+    static constexpr std::size_t kNoBlock = ~std::size_t(0);
+
+    RecordFormat  format_;
+    bool          frontCoded_;
+    std::string   bytes_;
+    std::size_t   blockStart_   = kNoBlock;  // header offset of the open block
+    std::uint32_t blockRecords_ = 0;
+    std::string   prevKey_;                  // front coding reference
+};
+
+// ------------------------------------------------------------------
+// BlockDecoder: walks the records of one binary block's payload.
+// Throws std::runtime_error on a malformed block.
+// ------------------------------------------------------------------
+class BlockDecoder {
+public:
+    // Header fields; false if `header` is not a block header
+    static bool readHeader(std::string_view header, std::uint8_t& flags,
+                           std::uint32_t& records, std::uint32_t& payloadBytes);
+
+    void reset(std::string_view payload, std::uint32_t records, std::uint8_t flags);
+    bool next(std::string_view& key, int& count);
+
+private:
+    const char*   p_    = nullptr;
+    const char*   end_  = nullptr;
+    std::uint32_t left_ = 0;
+    bool          frontCoded_ = false;
+    std::string   key_;   // front-coded key being rebuilt
+};
+
+// ------------------------------------------------------------------
+// RecordReader: the records of an intermediate file, or of a byte range
+// of one, in either format (detected from the first byte). Keys are
+// views that stay valid only until the following next().
+// ------------------------------------------------------------------
+class RecordReader {
+public:
+    explicit RecordReader(const InputSplit& range,
+                          std::size_t windowBytes = LineReader::kDefaultWindowBytes);
+    explicit RecordReader(const std::string& path,
+                          std::size_t windowBytes = LineReader::kDefaultWindowBytes)
+        : RecordReader(InputSplit{ path }, windowBytes) {}
+
+    RecordReader(const RecordReader&) = delete;
+    RecordReader& operator=(const RecordReader&) = delete;
+
+    RecordFormat format() const { return format_; }
+    bool next(std::string_view& key, int& count);
+
+private:
+    std::string  path_;
+    RecordFormat format_;
+    LineReader   reader_;
+    BlockDecoder block_;
+};
+
+// Calls fn(key, count) for every record in an in-memory buffer holding
+// whole records of either format (e.g. one pushed shuffle frame). Throws
+// std::runtime_error on a bad or truncated binary block.
+template <class Fn>
+void forEachRecord(std::string_view bytes, Fn&& fn) {
+    std::string_view key;
+    int count = 0;
+    if (!bytes.empty() && bytes[0] == '\0') {
+        BlockDecoder block;
+        while (!bytes.empty()) {
+            std::uint8_t flags = 0;
+            std::uint32_t records = 0, payload = 0;
+            if (!BlockDecoder::readHeader(bytes, flags, records, payload) ||
+                bytes.size() - kBlockHeaderBytes < payload) {
+                throw std::runtime_error("corrupt intermediate buffer");
+            }
+            block.reset(bytes.substr(kBlockHeaderBytes, payload), records, flags);
+            while (block.next(key, count)) fn(key, count);
+            bytes.remove_prefix(kBlockHeaderBytes + payload);
+        }
+        return;
+    }
+    for (std::size_t pos = 0; pos < bytes.size();) {
+        std::size_t nl = bytes.find('\n', pos);
+        if (nl == std::string_view::npos) nl = bytes.size();
+        if (parseRecord(bytes.substr(pos, nl - pos), key, count)) fn(key, count);
+        pos = nl + 1;
+    }
+}
+
+} // namespace mr
@@ -1,5 +1,6 @@
 #pragma once
 #include "FileManager.hpp"
+#include "ValueStream.hpp"
 #include <string>
 #include <vector>
 #include <utility>
@@ -12,14 +13,20 @@ using Count = int;
 class Reducer {
 public:
     Reducer(FileManager& fm, const std::string& outputDir);
+    // Writes to outputDir/fileName instead of word_counts{MR_OUTFILE_SUFFIX}.txt
+    Reducer(FileManager& fm, const std::string& outputDir, const std::string& fileName);
     void reduce(const Word& word, const std::vector<Count>& counts); // compute only
+    void reduce(const Word& word, IValueStream& values);             // sums as values stream in
     void exportResult(const Word& word, int total);                  // file IO
-    void markSuccess();
+    void markSuccess();                                              // flushes output first
+    void flush();                                                    // output to disk, no marker
+    const std::string& outputPath() const { return outFilePath_; }
 
 private:
     FileManager& fileManager_;
     std::string outputDir_;
     std::string outFilePath_;
+    AppendSink  out_;
 };
 
 } // namespace mr
@@ -0,0 +1,56 @@
+#pragma once
+#include "InputSplit.hpp"
+#include "LineReader.hpp"
+#include "LoserTree.hpp"
+#include "RecordFormat.hpp"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mr {
+
+// ------------------------------------------------------------------
+// RunMerge: k-way merge of key-sorted record files through a loser tree.
+// Walk it with valid() / word() / count() / pop(); records come out in
+// key order. word() points into a read window (or a front-coded key
+// buffer) and stays valid only until the next pop(). Runs may be in
+// either intermediate format (RecordFormat.hpp). A run may also be a
+// byte range of a file (e.g. one of several sorted runs stored back to
+// back).
+// ------------------------------------------------------------------
+class RunMerge {
+public:
+    explicit RunMerge(const std::vector<std::string>& runs,
+                      std::size_t windowBytes = LineReader::kDefaultWindowBytes);
+    explicit RunMerge(const std::vector<InputSplit>& runs,
+                      std::size_t windowBytes = LineReader::kDefaultWindowBytes);
+    RunMerge(const RunMerge&) = delete;
+    RunMerge& operator=(const RunMerge&) = delete;
+
+    bool             valid() const { return !tree_.empty(); }
+    std::string_view word() const  { return cursors_[tree_.top()].word; }
+    int              count() const { return cursors_[tree_.top()].count; }
+    void             pop()         { tree_.replay(!cursors_[tree_.top()].advance()); }
+
+private:
+    // Sequential reader over one run, exposing its current record
+    struct Cursor {
+        std::unique_ptr<RecordReader> reader;
+        std::string_view              word;
+        int                           count = 0;
+        bool advance();
+    };
+    struct CursorLess {
+        const std::vector<Cursor>* cursors;
+        bool operator()(std::size_t a, std::size_t b) const {
+            return (*cursors)[a].word < (*cursors)[b].word;
+        }
+    };
+
+    std::vector<Cursor>   cursors_;
+    LoserTree<CursorLess> tree_;
+};
+
+} // namespace mr
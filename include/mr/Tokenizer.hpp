@@ -0,0 +1,100 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+  #include <intrin.h>   // _BitScanForward64
+#endif
+
+namespace mr {
+
+// ------------------------------------------------------------------
+// Tokenizer: the word splitter shared by Mapper and the Map plugin.
+// A token is a maximal run of ASCII letters, lowercased; every other
+// byte separates tokens (same result as isalpha/tolower in the "C"
+// locale followed by whitespace splitting).
+//
+// A vector kernel folds a block of input and builds a one-bit-per-byte
+// letter mask in the same pass; token boundaries are then read off the
+// mask with bit scans. The kernel (AVX-512BW, AVX2, SSE2 or scalar) is
+// picked once at runtime from the CPU, or forced with MR_SIMD=<name>.
+// ------------------------------------------------------------------
+class Tokenizer {
+public:
+    using FoldFn = void (*)(const char* src, char* dst, std::uint64_t* letterMask, std::size_t n);
+
+    // Uses the selected kernel (kernelName())
+    Tokenizer();
+    // Uses the named kernel instead, e.g. to compare kernels; throws
+    // std::invalid_argument if this build or CPU cannot run it
+    explicit Tokenizer(std::string_view kernel);
+
+    // Fold n bytes: letters -> lowercase, anything else -> ' '.
+    // letterMask receives (n + 63) / 64 words, bit i set <=> src[i] is a letter.
+    static void fold(const char* src, char* dst, std::uint64_t* letterMask, std::size_t n);
+
+    // Name of the selected kernel ("avx512", "avx2", "sse2", "scalar")
+    static const char* kernelName();
+
+    // Kernels this build and CPU can run, fastest first
+    static std::vector<std::string> availableKernels();
+
+    // Calls fn(std::string_view token) for each token of line. Views point
+    // into this Tokenizer's buffer and are valid until the next call.
+    template <typename Fn>
+    void forEachToken(std::string_view line, Fn&& fn);
+
+private:
+    static unsigned lowestBit(std::uint64_t x);
+
+    FoldFn                     fold_;
+    std::string                folded_;
+    std::vector<std::uint64_t> mask_;
+};
+
+// ------------------------------------------------------------------
+template <typename Fn>
+void Tokenizer::forEachToken(std::string_view line, Fn&& fn) {
+    const std::size_t n = line.size();
+    if (n == 0) return;
+
+    const std::size_t words = (n + 63) / 64;
+    if (folded_.size() < n) folded_.resize(n);
+    if (mask_.size() < words) mask_.resize(words);
+
+    fold_(line.data(), &folded_[0], mask_.data(), n);
+    const char* base = folded_.data();
+
+    // A set bit in edges marks a letter/non-letter transition
+    std::uint64_t carry = 0;   // letter bit of the previous byte
+    std::size_t   start = 0;
+    bool          inTok = false;
+    for (std::size_t w = 0; w < words; ++w) {
+        const std::uint64_t bits = mask_[w];
+        std::uint64_t edges = bits ^ ((bits << 1) | carry);
+        carry = bits >> 63;
+        while (edges) {
+            const std::size_t pos = w * 64 + lowestBit(edges);
+            if (inTok) fn(std::string_view(base + start, pos - start));
+            else       start = pos;
+            inTok = !inTok;
+            edges &= edges - 1;
+        }
+    }
+    if (inTok) fn(std::string_view(base + start, n - start));
+}
+
+inline unsigned Tokenizer::lowestBit(std::uint64_t x) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long idx = 0;
+    _BitScanForward64(&idx, x);
+    return static_cast<unsigned>(idx);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(x));
+#endif
+}
+
+} // namespace mr
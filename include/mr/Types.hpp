@@ -6,12 +6,14 @@
 #include <utility>
 #include <map>
 
+#include "FlatCountTable.hpp" // mr::FlatCountTable (flat word -> count aggregation)
+#include "KVBuffer.hpp"       // mr::KVBuffer (structure-of-arrays pair buffer)
+
 namespace mr {
 
 using Word   = std::string;
 using Count  = int;
 using KVPair = std::pair<Word, Count>;
-using KVBuffer = std::vector<KVPair>;
 using Grouped = std::map<Word, std::vector<Count>>;
 
 } // namespace mr
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace mr {
+
+// ------------------------------------------------------------------
+// IValueStream: forward-only pull iterator over the values of one key.
+// The framework backs it with the sort/merge stream, so values are read
+// as the reducer asks for them and never collected into a list; a
+// reducer that folds them as they come needs O(1) memory per key.
+// Values not pulled before reduce returns are skipped.
+// ------------------------------------------------------------------
+struct IValueStream {
+    virtual ~IValueStream() = default;
+    // Next value into `value`; false once the key's values are exhausted
+    virtual bool next(int& value) = 0;
+};
+
+// Stream over an already materialized list (vector -> stream shim)
+class VectorValueStream : public IValueStream {
+public:
+    explicit VectorValueStream(const std::vector<int>& values) : values_(values) {}
+    bool next(int& value) override {
+        if (pos_ == values_.size()) return false;
+        value = values_[pos_++];
+        return true;
+    }
+
+private:
+    const std::vector<int>& values_;
+    std::size_t             pos_ = 0;
+};
+
+// Drain a stream into a list (stream -> vector shim)
+inline void collectValues(IValueStream& values, std::vector<int>& out) {
+    out.clear();
+    int v = 0;
+    while (values.next(v)) out.push_back(v);
+}
+
+} // namespace mr
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 #include <string>
 #include <vector>
 #include "mr/Types.hpp"      // <-- ADD this so Grouped is visible
@@ -6,6 +7,8 @@
 namespace mr {
 
 class FileManager;
+class ExternalSorter;
+class Reducer;
 
 class Workflow {
 public:
@@ -22,12 +25,27 @@ public:
 
   bool runWithPlugins(const std::string& dllDir);
 
+  // RAM budget of the sort & group phase (shared by all shards); larger
+  // inputs spill sorted runs to tempDir. Defaults to MR_SORT_MB (MiB) or 256 MiB.
+  void setSortMemoryLimit(std::size_t bytes);
+
+  // Threads (and hash shards) of the builtin map / sort / reduce phases.
+  // Defaults to MR_MAP_THREADS or every hardware thread.
+  void setThreads(unsigned threads);
+
 private:
-  void    doMapPhase();
-  Grouped doSortAndGroup();                    // keep signature as-is
-  void    doReducePhase(const Grouped& g);     // keep signature as-is
+  // Map, then sort & reduce every shard in parallel, then merge the
+  // shards' sorted outputs into word_counts.txt (counts: optional copy)
+  void runBuiltin(std::vector<std::pair<std::string,int>>* counts);
+
+  std::vector<std::string> doMapPhase();       // one intermediate file per shard
+  std::vector<std::string> reduceShards(const std::vector<std::string>& shards);
+  void doSortAndGroup(const std::string& intermediatePath, ExternalSorter& sorter);
+  void doReducePhase(ExternalSorter& sorter, Reducer& reducer); // consumes the sorted groups
 
   FileManager&   fileManager_;
   std::string    inputDir_, tempDir_, outputDir_;
+  std::size_t    sortMemoryBytes_;
+  unsigned       numThreads_;
 };
 } // namespace mr
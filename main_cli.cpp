@@ -1,15 +1,27 @@
 #include "mr/Workflow.hpp"
 #include "mr/FileManager.hpp"
+#include "mr/Job.hpp"
+#include <exception>
 #include <iostream>
 
 int main(int argc, char** argv) {
     std::string inputDir  = (argc > 1 ? argv[1] : "sample_input");
     std::string tempDir   = (argc > 2 ? argv[2] : "temp");
     std::string outputDir = (argc > 3 ? argv[3] : "output");
+    // 4th argument: a Map/Reduce plugin dir, or --static for the
+    // compile-time word count Job instead of the builtin Workflow
+    std::string pluginDir = (argc > 4 ? argv[4] : "");
 
     mr::FileManager fm;
     mr::Workflow wf(fm, inputDir, tempDir, outputDir);
-    wf.run();
+    try {
+        if (pluginDir.empty())           wf.run();
+        else if (pluginDir == "--static") mr::WordCountJob(fm, {}, {}).run(inputDir, outputDir);
+        else                             wf.runWithPlugins(pluginDir);
+    } catch (const std::exception& e) {
+        std::cerr << "MapReduce failed: " << e.what() << std::endl;
+        return 1;
+    }
 
     std::cout << "MapReduce completed. Results in " << outputDir << std::endl;
     return 0;
@@ -7,11 +7,21 @@
 #pragma comment(lib, "Ws2_32.lib")
 
 #include "mr/FileManager.hpp"
+#include "mr/InputSplit.hpp"
+#include "mr/LineReader.hpp"
 #include "mr/Mapper.hpp"
+#include "mr/PartitionFiles.hpp"
+#include "mr/PartitionStreams.hpp"
+#include "mr/Partitioner.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 static std::string recvLine(SOCKET s) {
@@ -57,20 +67,33 @@ static bool connectAndHandshakeMap(const std::string& host, int port, int mapper
     return (resp.find("BEGIN") == 0);
 }
 
-static std::vector<std::string> readManifest(const std::string& manifestPath) {
-    std::vector<std::string> files;
+// One split per line: "path" (whole file) or "path<TAB>offset<TAB>length".
+// Lines starting with '#' are directives (see InputSplit.hpp).
+static std::vector<mr::InputSplit> readManifest(const std::string& manifestPath,
+                                                std::string& rangeBoundsPath) {
+    std::vector<mr::InputSplit> splits;
     std::ifstream in(manifestPath);
     std::string line;
+    const std::string rangeDirective = std::string(mr::kRangeBoundsDirective) + "\t";
     while (std::getline(in, line)) {
-        if (!line.empty()) files.push_back(line);
+        if (line.rfind(rangeDirective, 0) == 0) {
+            rangeBoundsPath = line.substr(rangeDirective.size());
+            continue;
+        }
+        if (!line.empty() && line[0] == '#') continue;
+        mr::InputSplit s;
+        if (mr::parseSplit(line, s)) splits.push_back(std::move(s));
     }
-    return files;
+    return splits;
 }
 
 int main(int argc, char** argv) {
-    // mapper_worker.exe <mapperId> <numReducers> <manifestPath> <intermDir> <controllerHost> <controllerPort>
+    // mapper_worker.exe <mapperId> <numReducers> <manifestPath> <intermDir> <controllerHost> <controllerPort> [reducerEndpoints]
+    // With reducerEndpoints ("host:port,..." indexed by reducer id) the
+    // partitions are pushed to the reducers while mapping (push shuffle)
+    // instead of being written to intermDir.
     if (argc < 7) {
-        std::cerr << "Usage: mapper_worker <mapperId> <numReducers> <manifestPath> <intermDir> <controllerHost> <controllerPort>\n";
+        std::cerr << "Usage: mapper_worker <mapperId> <numReducers> <manifestPath> <intermDir> <controllerHost> <controllerPort> [reducerEndpoints]\n";
         return 1;
     }
 
@@ -88,22 +111,106 @@ int main(int argc, char** argv) {
 
     mr::FileManager fm;
     const std::size_t flushThreshold = 1000;
-    mr::Mapper mapper(fm, intermDir, flushThreshold, mapperId, numReducers);
 
-    auto files = readManifest(manifestPath);
-    if (files.empty()) {
+    // Map threads via MR_MAP_THREADS (default: every hardware thread)
+    unsigned numThreads = mr::mapThreadsFromEnv();
+
+    // In-mapper combining, budget in MiB via MR_COMBINE_MB (0 disables);
+    // the budget is split evenly between the threads
+    std::size_t combineBytes = mr::Mapper::kDefaultCombineBudget;
+    if (const char* v = std::getenv("MR_COMBINE_MB")) combineBytes = std::strtoull(v, nullptr, 10) << 20;
+
+    // Sort-based shuffle via MR_SORTED_RUNS=1: partition files become
+    // indexed sorted runs that reducers merge instead of re-aggregating
+    const char* sortedRunsEnv = std::getenv("MR_SORTED_RUNS");
+    const bool sortedRuns = sortedRunsEnv && std::string(sortedRunsEnv) == "1";
+
+    std::string rangeBoundsPath;
+    auto splits = readManifest(manifestPath, rangeBoundsPath);
+
+    std::shared_ptr<const mr::Partitioner> partitioner;
+    if (!rangeBoundsPath.empty()) {
+        auto bounds = mr::readRangeBounds(rangeBoundsPath);
+        if (bounds.size() + 1 != static_cast<std::size_t>(numReducers)) {
+            std::cerr << "[mapper_worker] bad range bounds file: " << rangeBoundsPath << "\n";
+            return 1;
+        }
+        partitioner = std::make_shared<mr::RangePartitioner>(std::move(bounds));
+    }
+    // An empty manifest still has to end its push streams, so no early exit
+    if (splits.empty()) {
         std::cerr << "[mapper_worker] manifest empty: " << manifestPath << "\n";
-        mapper.flush();
-        return 0;
     }
 
-    for (const auto& path : files) {
-        auto lines = fm.readAllLines(path);
-        for (const auto& line : lines) {
-            mapper.map(path, line);
+    // Cut the assigned splits into chunks so every thread has work even
+    // when this worker got a single large file
+    const std::vector<mr::InputSplit> work = mr::chunkSplits(splits);
+    numThreads = (std::max)(1u, (std::min)(numThreads, (unsigned)work.size()));
+
+    // Thread-local Mappers share one file (or push stream) per reducer bucket
+    std::shared_ptr<mr::PartitionStreams> streams;
+    std::shared_ptr<mr::PartitionSink> files;
+    if (argc >= 8) {
+        auto reducers = mr::parseEndpoints(argv[7]);
+        if (reducers.size() != static_cast<std::size_t>(numReducers)) {
+            std::cerr << "[mapper_worker] expected " << numReducers << " reducer endpoints\n";
+            return 1;
+        }
+        try {
+            streams = std::make_shared<mr::PartitionStreams>(mapperId, reducers);
+        } catch (const std::exception& e) {
+            std::cerr << "[mapper_worker] " << e.what() << "\n";
+            return 1;
+        }
+        files = streams;
+    } else {
+        files = std::make_shared<mr::PartitionFiles>(fm, intermDir, mapperId, numReducers);
+    }
+    std::atomic<std::size_t> nextChunk{ 0 };
+
+    auto mapChunks = [&]() {
+        mr::Mapper mapper(fm, files, flushThreshold);
+        mapper.enableCombiner(combineBytes / numThreads);
+        if (sortedRuns) mapper.enableSortedRuns();
+        if (partitioner) mapper.setPartitioner(partitioner);
+
+        for (std::size_t i; (i = nextChunk++) < work.size();) {
+            const auto& split = work[i];
+            mr::LineReader reader(split.path, split.offset, split.length);
+            std::string_view line;
+            while (reader.next(line)) {
+                mapper.map(split.path, line);
+            }
+        }
+        mapper.flush();
+    };
+
+    // A push failure in any thread is reported once all threads stopped
+    std::atomic<bool> failed{ false };
+    auto runChunks = [&]() {
+        try {
+            mapChunks();
+        } catch (const std::exception& e) {
+            std::cerr << "[mapper_worker] " << e.what() << "\n";
+            failed = true;
+            nextChunk = work.size();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < numThreads; ++t) pool.emplace_back(runChunks);
+    runChunks();
+    for (auto& th : pool) th.join();
+    if (failed) return 1;
+
+    files->flush();
+    if (streams) {
+        try {
+            streams->finish();
+        } catch (const std::exception& e) {
+            std::cerr << "[mapper_worker] " << e.what() << "\n";
+            return 1;
         }
     }
-
-    mapper.flush();
     return 0;
 }
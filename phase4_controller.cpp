@@ -1,10 +1,24 @@
 // phase4_controller.cpp (Phase 4 Controller - updated handshake-safe version)
 // Usage:
-//   mapreduce_phase4.exe <inputDir> <tempDir> <outputDir> <stubHost:port>[,<stubHost:port>...] [mappers] [reducers]
+//   mapreduce_phase4.exe <inputDir> <tempDir> <outputDir> <stubHost:port>[,<stubHost:port>...] [mappers] [reducers] [splitMB] [hash|range]
 // Example:
 //   mapreduce_phase4.exe sample_input temp output 127.0.0.1:5001 2 2
+//
+// Files larger than splitMB (default 64) are cut into byte-range splits so
+// one big file is spread over several mappers.
+//
+// "range" partitioning samples the input, gives each reducer a contiguous
+// key range, and builds word_counts.txt by concatenating the (sorted)
+// reducer outputs instead of merging and sorting them here.
+//
+// Shuffle: reducers pull their partitions from the stub that ran each
+// mapper (FETCH, see stub.cpp), so tempDir only has to be local to each
+// host. MR_SHUFFLE=shared makes reducers read tempDir directly instead,
+// for single-host runs or a directory shared by all hosts.
+// MR_SHUFFLE=push starts the reducers first; mappers then stream their
+// partitions straight to them while mapping, and reducers aggregate as
+// the data arrives instead of waiting for the whole map phase.
 
-#include <unordered_map>
 #include <chrono>
 #include <thread>
 
@@ -21,6 +35,14 @@
 #include <vector>
 #include <sstream>
 #include <algorithm>
+#include <cstdlib>
+
+#include "mr/FileManager.hpp"
+#include "mr/InputSplit.hpp"
+#include "mr/LineReader.hpp"
+#include "mr/Partitioner.hpp"
+#include "mr/RunMerge.hpp"
+#include "mr/Tokenizer.hpp"
 
 #pragma comment(lib, "Ws2_32.lib")
 namespace fs = std::filesystem;
@@ -50,13 +72,64 @@ static std::vector<fs::path> listTextFiles(const fs::path& inputDir) {
     return files;
 }
 
-static bool writeManifest(const fs::path& manifestPath, const std::vector<fs::path>& files) {
+static bool writeManifest(const fs::path& manifestPath, const std::vector<mr::InputSplit>& splits,
+                          const fs::path& rangeBounds) {
     std::ofstream out(manifestPath.string(), std::ios::trunc);
     if (!out) return false;
-    for (auto& p : files) out << p.string() << "\n";
+    if (!rangeBounds.empty()) out << mr::kRangeBoundsDirective << "\t" << rangeBounds.string() << "\n";
+    for (auto& s : splits) out << mr::formatSplit(s) << "\n";
     return true;
 }
 
+// Sample words from evenly spaced windows of every input file, tokenized
+// exactly like the mappers do, to place the range-partition split points.
+static std::vector<std::string> sampleInputKeys(const std::vector<fs::path>& inputs) {
+    const int windowsPerFile = 32;
+    const int linesPerWindow = 64;
+    std::vector<std::string> samples;
+    mr::Tokenizer tokenizer;
+
+    for (auto& p : inputs) {
+        std::error_code ec;
+        const std::uint64_t size = fs::file_size(p, ec);
+        if (ec || size == 0) continue;
+        for (int w = 0; w < windowsPerFile; ++w) {
+            const std::uint64_t off = size * w / windowsPerFile;
+            mr::LineReader reader(p.string(), off, size - off, 1u << 16);
+            std::string_view line;
+            for (int n = 0; n < linesPerWindow && reader.next(line); ++n) {
+                tokenizer.forEachToken(line, [&](std::string_view t) { samples.emplace_back(t); });
+            }
+        }
+    }
+    return samples;
+}
+
+// Cut inputs into splits and hand each split to the mapper with the fewest
+// bytes so far (largest splits first), so mappers finish at similar times.
+static std::vector<std::vector<mr::InputSplit>> assignSplits(const std::vector<fs::path>& inputs,
+                                                             int numMappers,
+                                                             std::uint64_t splitBytes) {
+    std::vector<std::pair<mr::InputSplit, std::uint64_t>> splits; // split, bytes
+    for (auto& p : inputs) {
+        std::error_code ec;
+        const std::uint64_t size = fs::file_size(p, ec);
+        for (auto& s : mr::makeSplits(p.string(), ec ? 0 : size, splitBytes))
+            splits.emplace_back(s, s.isWholeFile() ? size : s.length);
+    }
+    std::stable_sort(splits.begin(), splits.end(),
+                     [](auto& a, auto& b){ return a.second > b.second; });
+
+    std::vector<std::vector<mr::InputSplit>> assigns(numMappers);
+    std::vector<std::uint64_t> load(numMappers, 0);
+    for (auto& [split, bytes] : splits) {
+        const auto m = std::min_element(load.begin(), load.end()) - load.begin();
+        assigns[m].push_back(split);
+        load[m] += bytes;
+    }
+    return assigns;
+}
+
 // Read until '\n' (TCP-safe for short line messages)
 static std::string recvLine(SOCKET s) {
     std::string out;
@@ -132,50 +205,61 @@ static bool waitForReducerSuccessFiles(const fs::path& outputDir, int numReducer
     }
 }
 
-//Merge reducer outputs into word_counts.txt (aggregate + sort)
-static bool mergeReducerOutputs(const fs::path& outputDir, int numReducers) {
-    std::unordered_map<std::string, long long> agg;
+//Range partitioning: reducer outputs are sorted, disjoint key ranges in
+//bucket order, so the final file is their plain concatenation.
+static bool concatReducerOutputs(const fs::path& outputDir, int numReducers) {
+    fs::path outPath = outputDir / "word_counts.txt";
+    std::ofstream out(outPath.string(), std::ios::trunc | std::ios::binary);
+    if (!out) return false;
 
     for (int r = 0; r < numReducers; ++r) {
         fs::path inPath = outputDir / ("word_counts_r" + std::to_string(r) + ".txt");
-        std::ifstream in(inPath.string());
+        std::ifstream in(inPath.string(), std::ios::binary);
         if (!in) {
             std::cerr << "[controller] Missing reducer output: " << inPath.string() << "\n";
             return false;
         }
+        if (in.peek() != std::ifstream::traits_type::eof()) out << in.rdbuf();
+    }
 
-        std::string line;
-        while (std::getline(in, line)) {
-            if (line.empty()) continue;
-
-            // expect: word<TAB>count (or word count)
-            auto tab = line.find('\t');
-            if (tab == std::string::npos) tab = line.find(' ');
-            if (tab == std::string::npos) continue;
-
-            std::string w = line.substr(0, tab);
-            std::string cstr = line.substr(tab + 1);
+    std::cout << "[controller] Wrote concatenated output: " << outPath.string() << "\n";
+    return static_cast<bool>(out);
+}
 
-            try {
-                long long c = std::stoll(cstr);
-                if (!w.empty()) agg[w] += c;
-            } catch (...) {
-                // ignore malformed rows
-            }
+//Hash partitioning: every reducer output is key-sorted, so word_counts.txt
+//is a streaming k-way merge of them (equal keys summed). Memory stays at
+//one read window per reducer file plus the output buffer.
+static bool mergeReducerOutputs(const fs::path& outputDir, int numReducers) {
+    std::vector<std::string> inputs;
+    for (int r = 0; r < numReducers; ++r) {
+        fs::path inPath = outputDir / ("word_counts_r" + std::to_string(r) + ".txt");
+        if (!fs::exists(inPath)) {
+            std::cerr << "[controller] Missing reducer output: " << inPath.string() << "\n";
+            return false;
         }
+        inputs.push_back(inPath.string());
     }
 
-    std::vector<std::pair<std::string, long long>> rows(agg.begin(), agg.end());
-    std::sort(rows.begin(), rows.end(),
-              [](auto& a, auto& b){ return a.first < b.first; });
-
     fs::path outPath = outputDir / "word_counts.txt";
-    std::ofstream out(outPath.string(), std::ios::trunc);
-    if (!out) return false;
-
-    for (auto& [w, c] : rows) {
-        out << w << "\t" << c << "\n";
+    mr::FileManager fm;
+    mr::AppendSink out = fm.openAppend(outPath.string(), /*truncate*/ true);
+    if (!out.isOpen()) return false;
+
+    std::string word;
+    long long total = 0;
+    bool pending = false;
+    for (mr::RunMerge merge(inputs); merge.valid(); merge.pop()) {
+        if (pending && merge.word() == word) {
+            total += merge.count();
+            continue;
+        }
+        if (pending) out.writeRecord(word, total);
+        word.assign(merge.word().data(), merge.word().size());
+        total = merge.count();
+        pending = true;
     }
+    if (pending) out.writeRecord(word, total);
+    out.close();
 
     std::cout << "[controller] Wrote merged output: " << outPath.string() << "\n";
     return true;
@@ -186,7 +270,7 @@ static bool mergeReducerOutputs(const fs::path& outputDir, int numReducers) {
 int main(int argc, char** argv) {
     if (argc < 5) {
         std::cerr << "Usage:\n"
-                  << "  mapreduce_phase4 <inputDir> <tempDir> <outputDir> <stubHost:port>[,...] [mappers] [reducers]\n";
+                  << "  mapreduce_phase4 <inputDir> <tempDir> <outputDir> <stubHost:port>[,...] [mappers] [reducers] [splitMB] [hash|range]\n";
         return 1;
     }
 
@@ -197,6 +281,8 @@ int main(int argc, char** argv) {
     std::string stubsCsv = argv[4];
     int numMappers  = (argc >= 6) ? (std::max)(1, std::stoi(argv[5])) : 2;
     int numReducers = (argc >= 7) ? (std::max)(1, std::stoi(argv[6])) : 2;
+    std::uint64_t splitBytes = (argc >= 8) ? std::stoull(argv[7]) << 20 : (64ull << 20);
+    const bool rangePartition = (argc >= 9) && std::string(argv[8]) == "range";
 
     auto stubSpecs = split(stubsCsv, ',');
 
@@ -213,10 +299,26 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    // Partition files across mappers
-    std::vector<std::vector<fs::path>> assigns(numMappers);
-    for (size_t i = 0; i < inputs.size(); ++i)
-        assigns[i % (size_t)numMappers].push_back(inputs[i]);
+    // Partition input splits across mappers
+    auto assigns = assignSplits(inputs, numMappers, splitBytes);
+
+    // Range partitioning: publish sampled split points for the mappers
+    fs::path rangeBounds;
+    if (rangePartition) {
+        rangeBounds = tempDir / "range_bounds.dat";
+        auto bounds = mr::chooseRangeBounds(sampleInputKeys(inputs), (std::size_t)numReducers);
+        if (!mr::writeRangeBounds(rangeBounds.string(), bounds)) {
+            std::cerr << "[controller] Failed to write range bounds: " << rangeBounds.string() << "\n";
+            WSACleanup();
+            return 1;
+        }
+        std::cout << "[controller] Range partitioning with " << bounds.size() << " split points\n";
+        if ((int)bounds.size() + 1 < numReducers) {
+            // Too few distinct sampled keys to give every reducer a range
+            numReducers = (int)bounds.size() + 1;
+            std::cout << "[controller] Using " << numReducers << " reducer(s)\n";
+        }
+    }
 
     const int controllerPort = 6001;
     SOCKET hbListen = startHeartbeatServer(controllerPort);
@@ -234,93 +336,150 @@ int main(int argc, char** argv) {
         return {host, port};
     };
 
+    // MR_SHUFFLE: pull (default), shared or push
+    const char* shuffleEnv = std::getenv("MR_SHUFFLE");
+    const std::string shuffleMode = shuffleEnv ? shuffleEnv : "pull";
+
     // ------------- Tell stubs to SPAWN mappers -------------
-    for (int m = 0; m < numMappers; ++m) {
-        fs::path manifest = tempDir / ("mapper_input_" + std::to_string(m) + ".txt");
-        if (!writeManifest(manifest, assigns[m])) {
-            std::cerr << "[controller] Failed to write manifest: " << manifest.string() << "\n";
-            closesocket(hbListen);
-            WSACleanup();
-            return 1;
-        }
+    // reducerEndpoints: where mappers push their partitions (push shuffle only)
+    auto spawnMappers = [&](const std::string& reducerEndpoints) -> bool {
+        for (int m = 0; m < numMappers; ++m) {
+            fs::path manifest = tempDir / ("mapper_input_" + std::to_string(m) + ".txt");
+            if (!writeManifest(manifest, assigns[m], rangeBounds)) {
+                std::cerr << "[controller] Failed to write manifest: " << manifest.string() << "\n";
+                return false;
+            }
 
-        auto [host,port] = chooseStub(m);
-        std::ostringstream cmd;
-        cmd << "SPAWN|MAP|" << m << "|" << numReducers
-            << "|" << tempDir.string()
-            << "|" << manifest.string()
-            << "|" << "127.0.0.1"         // controller host for HELLO (local)
-            << "|" << controllerPort;     // controller port for HELLO
-
-        std::string resp;
-        if (!tcpSendLine(host, port, cmd.str(), resp)) {
-            std::cerr << "[controller] Stub unreachable: " << host << ":" << port << "\n";
-            closesocket(hbListen);
-            WSACleanup();
-            return 1;
+            auto [host,port] = chooseStub(m);
+            std::ostringstream cmd;
+            cmd << "SPAWN|MAP|" << m << "|" << numReducers
+                << "|" << tempDir.string()
+                << "|" << manifest.string()
+                << "|" << "127.0.0.1"         // controller host for HELLO (local)
+                << "|" << controllerPort;     // controller port for HELLO
+            if (!reducerEndpoints.empty()) cmd << "|" << reducerEndpoints;
+
+            std::string resp;
+            if (!tcpSendLine(host, port, cmd.str(), resp)) {
+                std::cerr << "[controller] Stub unreachable: " << host << ":" << port << "\n";
+                return false;
+            }
+            std::cout << "[controller] Stub response: " << resp << "\n";
         }
-        std::cout << "[controller] Stub response: " << resp << "\n";
-    }
+        return true;
+    };
 
-    // Accept mapper HELLO connections and send BEGIN
-    int mapperBegun = 0;
-    while (mapperBegun < numMappers) {
-        SOCKET s = accept(hbListen, nullptr, nullptr);
-        if (s == INVALID_SOCKET) continue;
-
-        std::string msg = recvLine(s);
-        if (startsWith(msg, "HELLO|MAP|")) {
-            const char* begin = "BEGIN\n";
-            send(s, begin, (int)strlen(begin), 0);
-            mapperBegun++;
-        } else {
-            std::cout << "[controller] Ignored msg: '" << msg << "'\n";
+    // ------------- Tell stubs to SPAWN reducers -------------
+    // shuffleArg: mapper stub list (pull), "push:<M>" or empty (shared dir)
+    auto spawnReducers = [&](const std::string& shuffleArg) -> bool {
+        for (int r = 0; r < numReducers; ++r) {
+            auto [host,port] = chooseStub(r);
+            std::ostringstream cmd;
+            cmd << "SPAWN|REDUCE|" << r << "|" << numMappers
+                << "|" << tempDir.string()
+                << "|" << outputDir.string()
+                << "|" << "127.0.0.1"
+                << "|" << controllerPort
+                << "|" << shuffleArg;
+
+            std::string resp;
+            if (!tcpSendLine(host, port, cmd.str(), resp)) {
+                std::cerr << "[controller] Stub unreachable for reducer: " << host << ":" << port << "\n";
+                return false;
+            }
+            std::cout << "[controller] Stub response: " << resp << "\n";
         }
-        closesocket(s);
-    }
+        return true;
+    };
 
-    // ------------- Tell stubs to SPAWN reducers -------------
-    for (int r = 0; r < numReducers; ++r) {
-        auto [host,port] = chooseStub(r);
-        std::ostringstream cmd;
-        cmd << "SPAWN|REDUCE|" << r << "|" << numMappers
-            << "|" << tempDir.string()
-            << "|" << outputDir.string()
-            << "|" << "127.0.0.1"
-            << "|" << controllerPort;
-
-        std::string resp;
-        if (!tcpSendLine(host, port, cmd.str(), resp)) {
-            std::cerr << "[controller] Stub unreachable for reducer: " << host << ":" << port << "\n";
-            closesocket(hbListen);
-            WSACleanup();
-            return 1;
+    // Accept worker HELLO connections (prefix "HELLO|MAP|" / "HELLO|REDUCE|")
+    // and send BEGIN. Push-shuffle reducers send "HELLO|REDUCE|<id>|<port>";
+    // their "peerHost:port" goes to (*endpoints)[id]. A push-shuffle HELLO
+    // without a usable id and port gets ERR instead of BEGIN and leaves its
+    // endpoint empty; it still counts as heard so the wait ends.
+    auto awaitHellos = [&](const char* prefix, int expected, std::vector<std::string>* endpoints) {
+        int heard = 0;
+        while (heard < expected) {
+            sockaddr_in peer{};
+            int peerLen = sizeof(peer);
+            SOCKET s = accept(hbListen, (sockaddr*)&peer, &peerLen);
+            if (s == INVALID_SOCKET) continue;
+
+            std::string msg = recvLine(s);
+            if (startsWith(msg, prefix)) {
+                bool accepted = true;
+                if (endpoints) {
+                    auto parts = split(msg, '|');
+                    const int id = (parts.size() >= 4) ? std::atoi(parts[2].c_str()) : -1;
+                    const int pushPort = (parts.size() >= 4) ? std::atoi(parts[3].c_str()) : 0;
+                    accepted = id >= 0 && id < (int)endpoints->size() &&
+                               (*endpoints)[id].empty() && pushPort > 0 && pushPort <= 65535;
+                    if (accepted) {
+                        char ip[INET_ADDRSTRLEN] = {};
+                        inet_ntop(AF_INET, &peer.sin_addr, ip, sizeof(ip));
+                        (*endpoints)[id] = std::string(ip) + ":" + std::to_string(pushPort);
+                    } else {
+                        std::cerr << "[controller] Rejected push-shuffle HELLO: '" << msg << "'\n";
+                    }
+                }
+                const char* reply = accepted ? "BEGIN\n" : "ERR\n";
+                send(s, reply, (int)strlen(reply), 0);
+                heard++;
+            } else {
+                std::cout << "[controller] Ignored msg: '" << msg << "'\n";
+            }
+            closesocket(s);
         }
-        std::cout << "[controller] Stub response: " << resp << "\n";
-    }
+    };
 
-    // Accept reducer HELLO connections and send BEGIN
-    int reducerBegun = 0;
-    while (reducerBegun < numReducers) {
-        SOCKET s = accept(hbListen, nullptr, nullptr);
-        if (s == INVALID_SOCKET) continue;
-
-        std::string msg = recvLine(s);
-        if (startsWith(msg, "HELLO|REDUCE|")) {
-            const char* begin = "BEGIN\n";
-            send(s, begin, (int)strlen(begin), 0);
-            reducerBegun++;
-        } else {
-            std::cout << "[controller] Ignored msg: '" << msg << "'\n";
+    bool spawned = false;
+    if (shuffleMode == "push") {
+        // Reducers first: mappers need their push ports before mapping, and
+        // reducers then aggregate while the mappers run
+        std::vector<std::string> endpoints(numReducers);
+        if (spawnReducers("push:" + std::to_string(numMappers))) {
+            awaitHellos("HELLO|REDUCE|", numReducers, &endpoints);
+            std::string reducerEndpoints;
+            bool complete = true;
+            for (int r = 0; r < numReducers; ++r) {
+                if (endpoints[r].empty()) {
+                    std::cerr << "[controller] Reducer " << r << " reported no push endpoint; aborting.\n";
+                    complete = false;
+                }
+                if (r) reducerEndpoints += ",";
+                reducerEndpoints += endpoints[r];
+            }
+            spawned = complete && spawnMappers(reducerEndpoints);
+            if (spawned) awaitHellos("HELLO|MAP|", numMappers, nullptr);
         }
-        closesocket(s);
+    } else if (spawnMappers("")) {
+        awaitHellos("HELLO|MAP|", numMappers, nullptr);
+
+        // Stub of every mapper, in mapper order: where reducers pull from
+        std::string mapperStubs;
+        if (shuffleMode != "shared") {
+            for (int m = 0; m < numMappers; ++m) {
+                auto [host,port] = chooseStub(m);
+                if (m) mapperStubs += ",";
+                mapperStubs += host + ":" + std::to_string(port);
+            }
+        }
+        spawned = spawnReducers(mapperStubs);
+        if (spawned) awaitHellos("HELLO|REDUCE|", numReducers, nullptr);
     }
-	
+    if (!spawned) {
+        closesocket(hbListen);
+        WSACleanup();
+        return 1;
+    }
+
 	// Wait for reducers to finish (they create SUCCESS_rX)
 	waitForReducerSuccessFiles(outputDir, numReducers);
 
 	// Merge reducer outputs into word_counts.txt
-	if (!mergeReducerOutputs(outputDir, numReducers)) {
+	const bool merged = rangePartition ? concatReducerOutputs(outputDir, numReducers)
+	                                   : mergeReducerOutputs(outputDir, numReducers);
+	if (!merged) {
 		std::cerr << "[controller] Final merge failed.\n";
 		closesocket(hbListen);
 		WSACleanup();
@@ -6,14 +6,19 @@
 #include <ws2tcpip.h>
 #pragma comment(lib, "Ws2_32.lib")
 
+#include "mr/ExternalSorter.hpp"
 #include "mr/FileManager.hpp"
+#include "mr/PartitionStreams.hpp"
 #include "mr/Reducer.hpp"
+#include "mr/RecordFormat.hpp"
 
+#include <atomic>
 #include <iostream>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
 #include <vector>
-#include <unordered_map>
-#include <sstream>
 #include <cstdlib>   // _putenv_s
 
 static std::string recvLine(SOCKET s) {
@@ -28,7 +33,8 @@ static std::string recvLine(SOCKET s) {
     return out;
 }
 
-static bool connectAndHandshakeReduce(const std::string& host, int port, int reducerId) {
+static bool connectAndHandshakeReduce(const std::string& host, int port, int reducerId,
+                                      int pushPort = 0) {
     WSADATA wsa{};
     if (WSAStartup(MAKEWORD(2,2), &wsa) != 0) return false;
 
@@ -51,8 +57,10 @@ static bool connectAndHandshakeReduce(const std::string& host, int port, int red
     std::cout << "[reducer_worker] connected to controller "
               << host << ":" << port << "\n";
 
-    // HELLO|REDUCE|<id>
-    std::string hello = "HELLO|REDUCE|" + std::to_string(reducerId) + "\n";
+    // HELLO|REDUCE|<id>[|<pushPort>]
+    std::string hello = "HELLO|REDUCE|" + std::to_string(reducerId);
+    if (pushPort) hello += "|" + std::to_string(pushPort);
+    hello += "\n";
     send(s, hello.c_str(), (int)hello.size(), 0);
 
     // wait BEGIN
@@ -71,11 +79,156 @@ static bool connectAndHandshakeReduce(const std::string& host, int port, int red
     return false;
 }
 
+// Pull bucket `reducerId` of mapper `mapperId` (or its sorted-run index)
+// from the stub that ran it ("FETCH|m|r[|runs]" -> "OK <bytes>" + raw
+// file) into `dest`.
+static bool fetchPartition(mr::FileManager& fm, const std::string& host, int port,
+                           int mapperId, int reducerId, bool runIndex, const std::string& dest) {
+    addrinfo hints{}, *res = nullptr;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    std::string portStr = std::to_string(port);
+    if (getaddrinfo(host.c_str(), portStr.c_str(), &hints, &res) != 0) return false;
+
+    SOCKET s = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (s == INVALID_SOCKET) { freeaddrinfo(res); return false; }
+
+    if (connect(s, res->ai_addr, (int)res->ai_addrlen) == SOCKET_ERROR) {
+        closesocket(s); freeaddrinfo(res); return false;
+    }
+    freeaddrinfo(res);
+
+    std::string req = "FETCH|" + std::to_string(mapperId) + "|" + std::to_string(reducerId) +
+                      (runIndex ? "|runs\n" : "\n");
+    send(s, req.c_str(), (int)req.size(), 0);
+
+    // The stub answers once the mapper has exited
+    std::string header = recvLine(s);
+    if (header.rfind("OK ", 0) != 0) { closesocket(s); return false; }
+    const unsigned long long expected = std::strtoull(header.c_str() + 3, nullptr, 10);
+
+    mr::AppendSink out = fm.openAppend(dest, /*truncate*/ true);
+    std::vector<char> buf(1u << 20);
+    unsigned long long received = 0;
+    while (received < expected) {
+        int n = recv(s, buf.data(), (int)buf.size(), 0);
+        if (n <= 0) break;
+        out.write(std::string_view(buf.data(), (std::size_t)n));
+        received += (unsigned long long)n;
+    }
+    out.close();
+    closesocket(s);
+    return received == expected;
+}
+
+// Fetch this reducer's bucket and its run index (empty for unsorted
+// output) from every mapper at once (one thread per mapper) into `dir`;
+// empty result if any transfer failed.
+static std::vector<std::string> fetchPartitions(mr::FileManager& fm,
+                                                const std::vector<std::pair<std::string, int>>& stubs,
+                                                int reducerId, const std::string& dir) {
+    WSADATA wsa{};
+    if (WSAStartup(MAKEWORD(2,2), &wsa) != 0) return {};
+
+    std::vector<std::string> paths(stubs.size());
+    std::atomic<bool> ok{ true };
+    std::vector<std::thread> pool;
+    for (std::size_t m = 0; m < stubs.size(); ++m) {
+        paths[m] = dir + "/m" + std::to_string(m) + "_r" + std::to_string(reducerId) + ".txt";
+        pool.emplace_back([&, m]() {
+            const auto& [host, port] = stubs[m];
+            if (!fetchPartition(fm, host, port, (int)m, reducerId, false, paths[m]) ||
+                !fetchPartition(fm, host, port, (int)m, reducerId, true, mr::runIndexPath(paths[m]))) {
+                std::cerr << "[reducer_worker] fetch from mapper " << m << " ("
+                          << stubs[m].first << ":" << stubs[m].second << ") failed\n";
+                ok = false;
+            }
+        });
+    }
+    for (auto& th : pool) th.join();
+    WSACleanup();
+
+    if (!ok) return {};
+    return paths;
+}
+
+// Push shuffle listener on an ephemeral port (reported to the controller)
+static SOCKET openPushListener(int& port) {
+    SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == INVALID_SOCKET) return INVALID_SOCKET;
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = 0;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    int len = sizeof(addr);
+    if (bind(s, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR ||
+        listen(s, SOMAXCONN) == SOCKET_ERROR ||
+        getsockname(s, (sockaddr*)&addr, &len) == SOCKET_ERROR) {
+        closesocket(s);
+        return INVALID_SOCKET;
+    }
+    port = ntohs(addr.sin_port);
+    return s;
+}
+
+// Push shuffle: take one stream from each of numMappers mappers and fold
+// every frame into the sorter as it arrives, so aggregation overlaps the
+// map phase. True once every mapper has sent its end-of-stream frame.
+static bool receivePushed(SOCKET listenSock, int numMappers, mr::ExternalSorter& totals) {
+    std::mutex totalsMu;
+    std::mutex doneMu;
+    std::set<int> done;   // mappers whose stream ended cleanly
+
+    auto receive = [&](SOCKET s) {
+        const std::string hello = recvLine(s);
+        const std::size_t helloLen = std::char_traits<char>::length(mr::kPushHello);
+        if (hello.compare(0, helloLen, mr::kPushHello) != 0) { closesocket(s); return; }
+        const int mapperId = std::atoi(hello.c_str() + helloLen);
+
+        std::string frame;
+        while (mr::recvFrame(s, frame)) {
+            if (frame.empty()) {
+                std::lock_guard<std::mutex> lk(doneMu);
+                done.insert(mapperId);
+                break;
+            }
+            std::lock_guard<std::mutex> lk(totalsMu);
+            try {
+                mr::forEachRecord(frame, [&](std::string_view word, int count) {
+                    totals.add(word, count);
+                });
+            } catch (const std::exception& e) {
+                // Never marked done, so the shuffle is reported incomplete
+                std::cerr << "[reducer_worker] push shuffle: bad frame from mapper " << mapperId
+                          << ": " << e.what() << "\n";
+                break;
+            }
+        }
+        closesocket(s);
+    };
+
+    std::vector<std::thread> pool;
+    for (int m = 0; m < numMappers; ++m) {
+        SOCKET s = accept(listenSock, nullptr, nullptr);
+        if (s == INVALID_SOCKET) break;
+        pool.emplace_back(receive, s);
+    }
+    for (auto& th : pool) th.join();
+    return done.size() == static_cast<std::size_t>(numMappers);
+}
 
 int main(int argc, char** argv) {
-    // reducer_worker.exe <reducerId> <intermDir> <outputDir> <controllerHost> <controllerPort>
+    // reducer_worker.exe <reducerId> <intermDir> <outputDir> <controllerHost> <controllerPort> [shuffle]
+    // shuffle:
+    //   (none)              read the partitions from intermDir (shared directory)
+    //   host:port,...       pull them from the stub of each mapper (indexed by
+    //                       mapper id) into intermDir/shuffle_r<id>
+    //   push:<numMappers>   listen on an ephemeral port, report it in HELLO and
+    //                       aggregate the mappers' pushed frames as they arrive
     if (argc < 6) {
-        std::cerr << "Usage: reducer_worker <reducerId> <intermDir> <outputDir> <controllerHost> <controllerPort>\n";
+        std::cerr << "Usage: reducer_worker <reducerId> <intermDir> <outputDir> <controllerHost> <controllerPort> [shuffle]\n";
         return 1;
     }
 
@@ -84,8 +237,24 @@ int main(int argc, char** argv) {
     std::string outputDir = argv[3];
     std::string controllerHost = argv[4];
     int controllerPort = std::stoi(argv[5]);
+    const std::string shuffle = argc >= 7 ? argv[6] : "";
+    const bool pushed = shuffle.rfind("push:", 0) == 0;
+    const bool pulled = !pushed && !shuffle.empty();
 
-    if (!connectAndHandshakeReduce(controllerHost, controllerPort, reducerId)) {
+    // Push mode listens before HELLO: the controller hands the port to the mappers
+    WSADATA wsa{};
+    SOCKET pushListen = INVALID_SOCKET;
+    int pushPort = 0;
+    if (pushed) {
+        if (WSAStartup(MAKEWORD(2,2), &wsa) != 0) return 1;
+        pushListen = openPushListener(pushPort);
+        if (pushListen == INVALID_SOCKET) {
+            std::cerr << "[reducer_worker] cannot open push listener\n";
+            return 1;
+        }
+    }
+
+    if (!connectAndHandshakeReduce(controllerHost, controllerPort, reducerId, pushPort)) {
         std::cerr << "[reducer_worker] handshake failed\n";
         return 1;
     }
@@ -99,32 +268,62 @@ int main(int argc, char** argv) {
     mr::FileManager fm;
     mr::Reducer reducer(fm, outputDir);
 
-    std::unordered_map<std::string, std::vector<int>> grouped;
-    auto files = fm.listTextFiles(intermDir);
-
-    const std::string suffixFile = "_r" + std::to_string(reducerId) + ".txt";
-
-    for (const auto& path : files) {
-        if (path.size() < suffixFile.size() ||
-            path.substr(path.size() - suffixFile.size()) != suffixFile) {
-            continue;
+    // The builtin Reducer sums, so counts are aggregated on arrival in a
+    // table capped at MR_SORT_MB; past the cap it spills key-sorted runs
+    // of partial sums to intermDir, merged (and summed) at the end. Memory
+    // stays bounded however large the partition is.
+    const char* sortMb = std::getenv("MR_SORT_MB");
+    const long long mb = sortMb ? std::atoll(sortMb) : 0;
+    mr::ExternalSorter totals(fm, intermDir + "/reduce_r" + std::to_string(reducerId) + "_run",
+                              mb > 0 ? static_cast<std::size_t>(mb) << 20 : mr::ExternalSorter::kDefaultMemoryBytes);
+    totals.combineBySum();
+    std::vector<std::string> files;
+    if (pushed) {
+        const bool complete = receivePushed(pushListen, std::atoi(shuffle.c_str() + 5), totals);
+        closesocket(pushListen);
+        WSACleanup();
+        if (!complete) {
+            std::cerr << "[reducer_worker] push shuffle: a mapper stream ended early\n";
+            return 1;
         }
-
-        auto lines = fm.readAllLines(path);
-        for (const auto& line : lines) {
-            if (line.empty()) continue;
-
-            std::istringstream iss(line);
-            std::string word;
-            int count = 0;
-            if (!(iss >> word >> count)) continue;
-
-            grouped[word].push_back(count);
+    } else if (pulled) {
+        const std::string shuffleDir = intermDir + "/shuffle_r" + std::to_string(reducerId);
+        files = fetchPartitions(fm, mr::parseEndpoints(shuffle), reducerId, shuffleDir);
+        if (files.empty()) {
+            std::cerr << "[reducer_worker] shuffle fetch failed\n";
+            return 1;
+        }
+    } else {
+        const std::string suffixFile = "_r" + std::to_string(reducerId) + ".txt";
+        for (auto& path : fm.listTextFiles(intermDir)) {
+            if (path.size() >= suffixFile.size() &&
+                path.compare(path.size() - suffixFile.size(), suffixFile.size(), suffixFile) == 0) {
+                files.push_back(std::move(path));
+            }
         }
     }
 
-    for (auto& kv : grouped) {
-        reducer.reduce(kv.first, kv.second);
+    // Sort-based shuffle: partition files that come with a run index hold
+    // sorted runs, which are merged as they are instead of re-aggregated
+    for (const auto& path : files) {
+        auto runs = mr::readRunIndex(path);
+        if (runs.empty()) totals.addFile(path);
+        for (auto& run : runs) totals.addSortedRun(std::move(run));
+    }
+    // Key-sorted output: with range partitioning the controller can then
+    // concatenate reducer files instead of sorting them again.
+    totals.forEachGroupStream([&](const std::string& word, mr::IValueStream& partials) {
+        int total = 0;
+        for (int v; partials.next(v);) total += v;
+        reducer.exportResult(word, total);
+    });
+
+    // Sorted runs are read during the merge, so fetched copies go only now
+    if (pulled) {
+        for (const auto& path : files) {
+            fm.removeFile(path);
+            fm.removeFile(mr::runIndexPath(path));
+        }
     }
 
     reducer.markSuccess();
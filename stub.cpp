@@ -2,23 +2,34 @@
 // Usage: phase4_stub.exe <port> <controllerHost> <controllerPort>
 // Example: phase4_stub.exe 5001 127.0.0.1 6001
 //
-// Receives: SPAWN|MAP|m|R|tempDir|manifestPath
-//   -> runs: mapper_worker.exe m R "manifestPath" "tempDir" controllerHost controllerPort
+// Receives: SPAWN|MAP|m|R|tempDir|manifestPath[|ctrlHost|ctrlPort|reducerEndpoints]
+//   -> runs: mapper_worker.exe m R "manifestPath" "tempDir" controllerHost controllerPort [reducerEndpoints]
 //
-// Receives: SPAWN|REDUCE|r|M|tempDir|outputDir
-//   -> runs: reducer_worker.exe r "tempDir" "outputDir" controllerHost controllerPort
+// Receives: SPAWN|REDUCE|r|M|tempDir|outputDir[|ctrlHost|ctrlPort|shuffle]
+//   -> runs: reducer_worker.exe r "tempDir" "outputDir" controllerHost controllerPort [shuffle]
+//
+// Receives: FETCH|m|r[|runs]   (shuffle service, see serveFetch)
+//   -> waits for mapper m spawned here to exit, then replies "OK <bytes>"
+//      followed by the raw contents of its partition file m<m>_r<r>.txt
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #include <winsock2.h>
 #include <ws2tcpip.h>
 
+#include <mswsock.h>
+
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include <sstream>
 
 #pragma comment(lib, "Ws2_32.lib")
+#pragma comment(lib, "Mswsock.lib")
 
 static std::vector<std::string> split(const std::string& s, char delim) {
     std::vector<std::string> out;
@@ -41,7 +52,10 @@ static std::string recvLine(SOCKET s) {
     return out;
 }
 
-static bool spawnProcess(const std::wstring& cmdLine) {
+// Process handle, closed when the last holder lets go
+using ProcessHandle = std::shared_ptr<void>;
+
+static bool spawnProcess(const std::wstring& cmdLine, ProcessHandle* processOut = nullptr) {
     STARTUPINFOW si{};
     si.cb = sizeof(si);
     PROCESS_INFORMATION pi{};
@@ -68,7 +82,8 @@ static bool spawnProcess(const std::wstring& cmdLine) {
     }
 
     CloseHandle(pi.hThread);
-    CloseHandle(pi.hProcess);
+    if (processOut) processOut->reset(pi.hProcess, CloseHandle);
+    else            CloseHandle(pi.hProcess);
     return true;
 }
 
@@ -85,6 +100,96 @@ static std::wstring q(const std::wstring& s) {
     return L"\"" + s + L"\"";
 }
 
+// ------------------- shuffle service -------------------
+// Mappers spawned by this stub write their partition files to a local
+// temp dir; reducers pull them over TCP (FETCH) instead of reading a
+// directory shared by every host.
+struct MapOutput {
+    std::string   tempDir;
+    ProcessHandle process;
+};
+
+static std::mutex                 g_mapMutex;
+static std::map<int, MapOutput>   g_mapOutputs;   // mapperId -> where/when its output is ready
+
+// Non-negative decimal id, -1 for anything else
+static int parseId(const std::string& s) {
+    if (s.empty() || s.size() > 9 || s.find_first_not_of("0123456789") != std::string::npos) return -1;
+    return std::stoi(s);
+}
+
+static bool sendAll(SOCKET s, const char* data, int len) {
+    while (len > 0) {
+        int n = send(s, data, len, 0);
+        if (n <= 0) return false;
+        data += n; len -= n;
+    }
+    return true;
+}
+
+// FETCH|m|r[|runs]: wait for mapper m, then stream m<m>_r<r>.txt (or its
+// sorted-run index, m<m>_r<r>.txt.runs) with TransmitFile
+// (kernel copies file pages straight to the socket, no user-space buffer).
+// A missing bucket file is an error (the mapper writes every bucket, empty
+// or not); a missing run index just means the bucket holds no sorted runs.
+static void serveFetch(SOCKET s, int mapperId, int reducerId, bool runIndex) {
+    MapOutput out;
+    {
+        std::lock_guard<std::mutex> lock(g_mapMutex);
+        auto it = g_mapOutputs.find(mapperId);
+        if (it != g_mapOutputs.end()) out = it->second;
+    }
+
+    DWORD exitCode = 1;
+    if (out.process) {
+        WaitForSingleObject(out.process.get(), INFINITE);
+        GetExitCodeProcess(out.process.get(), &exitCode);
+    }
+    if (exitCode != 0) {
+        std::cerr << "[stub] FETCH m" << mapperId << " r" << reducerId << ": mapper not available\n";
+        sendAll(s, "ERR\n", 4);
+        closesocket(s);
+        return;
+    }
+
+    const std::string path = out.tempDir + "\\m" + std::to_string(mapperId) +
+                             "_r" + std::to_string(reducerId) + (runIndex ? ".txt.runs" : ".txt");
+    HANDLE file = CreateFileW(widen(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    const bool noRuns = file == INVALID_HANDLE_VALUE && runIndex &&
+                        GetLastError() == ERROR_FILE_NOT_FOUND;
+    LARGE_INTEGER size{};   // an absent run index goes out as an empty one
+    if (!noRuns && (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size))) {
+        std::cerr << "[stub] FETCH cannot read " << path << "\n";
+        sendAll(s, "ERR\n", 4);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        closesocket(s);
+        return;
+    }
+
+    const std::string header = "OK " + std::to_string(size.QuadPart) + "\n";
+    bool ok = sendAll(s, header.c_str(), (int)header.size());
+
+    // TransmitFile moves at most 2 GiB - 2 per call and starts at the file
+    // pointer, which it does not advance for a synchronous handle: seek to
+    // the bytes already sent before every chunk.
+    const LONGLONG maxChunk = 1ll << 30;
+    for (LONGLONG sent = 0; ok && sent < size.QuadPart;) {
+        const LONGLONG left = size.QuadPart - sent;
+        const DWORD chunk = (DWORD)(left < maxChunk ? left : maxChunk);
+        LARGE_INTEGER pos{};
+        pos.QuadPart = sent;
+        ok = SetFilePointerEx(file, pos, nullptr, FILE_BEGIN) != FALSE &&
+             TransmitFile(s, file, chunk, 0, nullptr, nullptr, 0) != FALSE;
+        sent += chunk;
+    }
+    if (!ok) std::cerr << "[stub] FETCH transfer failed: " << path << "\n";
+
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    shutdown(s, SD_SEND);
+    closesocket(s);
+}
+
 int main(int argc, char** argv) {
     if (argc < 4) {
         std::cerr << "Usage: phase4_stub <port> <controllerHost> <controllerPort>\n";
@@ -129,36 +234,51 @@ int main(int argc, char** argv) {
         std::string line = recvLine(s);
         auto parts = split(line, '|');
 
+        // Transfers can be long: one thread per fetch, accept loop keeps going
+        if (parts.size() >= 3 && parts[0] == "FETCH" &&
+            parseId(parts[1]) >= 0 && parseId(parts[2]) >= 0) {
+            const bool runIndex = parts.size() >= 4 && parts[3] == "runs";
+            std::thread(serveFetch, s, parseId(parts[1]), parseId(parts[2]), runIndex).detach();
+            continue;
+        }
+
         bool ok = false;
 
         if (parts.size() >= 2 && parts[0] == "SPAWN") {
             if (parts[1] == "MAP" && parts.size() >= 6) {
-                // SPAWN|MAP|m|R|tempDir|manifestPath
+                // SPAWN|MAP|m|R|tempDir|manifestPath[|ctrlHost|ctrlPort|reducerEndpoints]
                 std::string mapperId = parts[2];
                 std::string R        = parts[3];
                 std::string tempDir  = parts[4];
                 std::string manifest = parts[5];
 
-                // mapper_worker.exe <mapperId> <numReducers> "<manifestPath>" "<intermDir>" <controllerHost> <controllerPort>
+                // mapper_worker.exe <mapperId> <numReducers> "<manifestPath>" "<intermDir>" <controllerHost> <controllerPort> [reducerEndpoints]
                 std::wstring cmd =
                     L"mapper_worker.exe " + widen(mapperId) + L" " + widen(R) + L" " +
                     q(widen(manifest)) + L" " + q(widen(tempDir)) + L" " +
                     widen(controllerHost) + L" " + widen(std::to_string(controllerPort));
+                if (parts.size() >= 9 && !parts[8].empty()) cmd += L" " + widen(parts[8]);
 
                 std::wcout << L"[stub] SPAWN MAP cmd: " << cmd << L"\n";
-                ok = spawnProcess(cmd);
+                MapOutput output{ tempDir, nullptr };
+                ok = spawnProcess(cmd, &output.process);
+                if (ok) {
+                    std::lock_guard<std::mutex> lock(g_mapMutex);
+                    g_mapOutputs[parseId(mapperId)] = std::move(output);
+                }
             }
             else if (parts[1] == "REDUCE" && parts.size() >= 6) {
-                // SPAWN|REDUCE|r|M|tempDir|outputDir
+                // SPAWN|REDUCE|r|M|tempDir|outputDir[|ctrlHost|ctrlPort|shuffle]
                 std::string reducerId = parts[2];
                 std::string tempDir   = parts[4];
                 std::string outDir    = parts[5];
 
-                // reducer_worker.exe <reducerId> "<intermDir>" "<outputDir>" <controllerHost> <controllerPort>
+                // reducer_worker.exe <reducerId> "<intermDir>" "<outputDir>" <controllerHost> <controllerPort> [shuffle]
                 std::wstring cmd =
                     L"reducer_worker.exe " + widen(reducerId) + L" " +
                     q(widen(tempDir)) + L" " + q(widen(outDir)) + L" " +
                     widen(controllerHost) + L" " + widen(std::to_string(controllerPort));
+                if (parts.size() >= 9 && !parts[8].empty()) cmd += L" " + widen(parts[8]);
 
                 std::wcout << L"[stub] SPAWN REDUCE cmd: " << cmd << L"\n";
                 ok = spawnProcess(cmd);